@@ -34,6 +34,7 @@
 #pragma once
 
 #include "SpecializationPolicy.h"
+#include "SpecializationTable.h"
 #include "llvm/ADT/DenseMap.h"
 
 namespace previrt {
@@ -46,6 +47,8 @@ namespace previrt {
    * also agrees.
   */
   class BoundedSpecPolicy : public SpecializationPolicy {
+    // Specializations are never copied again
+    const SpecializationTable& m_table;
     std::unique_ptr<SpecializationPolicy> m_subpolicy;
     const unsigned m_threshold;
     llvm::DenseMap<const llvm::Function*, unsigned> m_num_copy_map;
@@ -57,6 +60,7 @@ namespace previrt {
   public:
 
     BoundedSpecPolicy(llvm::Module &M,
+		      const SpecializationTable &table,
 		      std::unique_ptr<SpecializationPolicy> subpolicy,
 		      unsigned threshold);
 
@@ -0,0 +1,159 @@
+//
+// OCCAM
+//
+// Copyright (c) 2011-2020, SRI International
+//
+//  All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of SRI International nor the names of its contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include "llvm/ADT/StringRef.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PrevirtualizeInterfaces.h"
+
+namespace llvm
+{
+  class MemoryBuffer;
+}
+
+/*
+ * Binary format of interface (.iface) and rewrite (.rw) files that is
+ * queried in place through mmap instead of being parsed.
+ *
+ * All the integers are 32-bit little-endian. The file starts with
+ *
+ *   magic "OCCAMIFX", version, flags (1 for a rewrite file),
+ *   number of functions, offset of the function table,
+ *   number of references, offset of the reference table,
+ *   number of calls, offset of the call index,
+ *   offset of the string area
+ *
+ * The function table is sorted by name. Each entry is (name, first
+ * call, number of calls), where a name is an (offset, size) pair into
+ * the string area and calls are positions in the call index. The
+ * reference table is the sorted list of referenced names. The call
+ * index holds the offset of each call record:
+ *
+ *   count, number of arguments, rewrite name, number of rewrite args,
+ *   arguments (4 words each: kind|flag|float semantics, bits, a, b),
+ *   rewrite args
+ *
+ * where a call without rewrite has the rewrite name offset ~0. An
+ * integer or float argument of at most 64 bits is stored in (a, b),
+ * a wider one is an (offset, words) pair into the string area.
+ *
+ * Protobuf remains the interchange format (razor reads and writes
+ * it). The readers of libprevirt accept both formats.
+ */
+namespace previrt
+{
+  class MappedInterface {
+  private:
+    std::unique_ptr<llvm::MemoryBuffer> buffer;
+    const char* base;
+    size_t size;
+
+    unsigned flags;
+    unsigned numFunctions;
+    unsigned functionsOffset;
+    unsigned numReferences;
+    unsigned referencesOffset;
+    unsigned numCalls;
+    unsigned callsOffset;
+    unsigned stringsOffset;
+
+    MappedInterface(std::unique_ptr<llvm::MemoryBuffer> buffer);
+
+    unsigned word(size_t offset) const;
+    llvm::StringRef string(size_t offset) const;
+    size_t callRecord(unsigned f, unsigned c) const;
+    void readCalls(unsigned f, ComponentInterface& out) const;
+    void readCalls(unsigned f, ComponentInterfaceTransform& out) const;
+
+    // Check that all the records and strings are within the file
+    bool validString(size_t offset) const;
+    bool validate() const;
+
+  public:
+    ~MappedInterface();
+
+    // Return null if filename is not in the mapped format or it is
+    // truncated or corrupt.
+    static std::unique_ptr<MappedInterface> open(const std::string& filename);
+
+    // Whether the file is a rewrite file
+    bool isTransform() const;
+
+    // Functions, sorted by name
+    unsigned functions() const;
+    llvm::StringRef functionName(unsigned f) const;
+    // Return the index of the function or -1
+    int findFunction(llvm::StringRef name) const;
+
+    // Calls to a function
+    unsigned calls(unsigned f) const;
+    unsigned callCount(unsigned f, unsigned c) const;
+    unsigned args(unsigned f, unsigned c) const;
+    PrevirtType arg(unsigned f, unsigned c, unsigned i) const;
+    // Return false if the call is not rewritten
+    bool rewrite(unsigned f, unsigned c, llvm::StringRef& function,
+                 std::vector<unsigned>& args) const;
+
+    // References, sorted
+    unsigned references() const;
+    llvm::StringRef reference(unsigned r) const;
+    bool isReferenced(llvm::StringRef name) const;
+
+    // Decode only the calls to name and their rewrites. The caller
+    // must compile() out once it has read all the functions it needs.
+    // Return false if the file has no calls to name.
+    bool readCallsInto(llvm::StringRef name,
+                       ComponentInterfaceTransform& out) const;
+
+    // Decode the whole file
+    void readInto(ComponentInterface& out) const;
+    void readInto(ComponentInterfaceTransform& out) const;
+  };
+
+  bool writeMappedInterface(const ComponentInterface& iface,
+                            const std::string& filename);
+  bool writeMappedTransform(const ComponentInterfaceTransform& transform,
+                            const std::string& filename);
+
+  // Write an interface or rewrite file in the format selected with
+  // -Pmapped-output (protobuf by default).
+  bool writeInterfaceFile(const ComponentInterface& iface,
+                          const std::string& filename);
+  bool writeTransformFile(const ComponentInterfaceTransform& transform,
+                          const std::string& filename);
+}
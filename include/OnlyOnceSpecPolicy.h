@@ -34,6 +34,7 @@
 #pragma once
 
 #include "SpecializationPolicy.h"
+#include "SpecializationTable.h"
 #include "llvm/ADT/DenseSet.h"
 
 namespace previrt {
@@ -46,17 +47,19 @@ namespace previrt {
    * 1.
    */
   class OnlyOnceSpecPolicy : public SpecializationPolicy {
+    // Specializations are never copied again
+    const SpecializationTable& m_table;
     // Functions that cannot be copied because it is called more than
     // once. Used only for intra specialization.
     llvm::DenseSet<const llvm::Function*> m_blacklist;
   public:
 
     // Constructor for inter specialization
-    OnlyOnceSpecPolicy() = default;
+    OnlyOnceSpecPolicy(const SpecializationTable &table);
 
     // Constructor for intra specialization: the module is used to
     // precompute information for faster queries.
-    OnlyOnceSpecPolicy(llvm::Module &M);
+    OnlyOnceSpecPolicy(llvm::Module &M, const SpecializationTable &table);
     
     virtual ~OnlyOnceSpecPolicy() = default;
 
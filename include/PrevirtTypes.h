@@ -43,12 +43,20 @@
 #include "Serializer.h"
 #include "proto/Previrt.pb.h"
 
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/StringRef.h"
+
 #include <map>
+#include <string>
+#include <vector>
 
 namespace llvm {
   class Value;
   class Type;
+  class Function;
+  class Module;
   class LLVMContext;
+  struct fltSemantics;
 }
 
 namespace previrt {
@@ -56,24 +64,48 @@ namespace previrt {
 #define EXACT_MATCH  0
 #define LOOSE_MATCH  1
 
+  // An abstraction of the value of an argument. The representation is
+  // a tagged value: integers and float bit patterns are APInts (which
+  // are inline up to 64 bits), strings and global names are interned.
+  // The protobuf message is only built when the type is serialized.
   class PrevirtType {
+  public:
+    enum Kind {
+      UNKNOWN, // unknown
+      INT,     // integer
+      FLOAT,   // float
+      STRING,  // string
+      NUL,     // null value of any type
+      GLOBAL   // global
+    };
+
   private:
-    proto::PrevirtType buffer;
-    typedef std::map<llvm::Type*, llvm::Function*> EqCache;
-    static EqCache cacheEq;
+    Kind kind;
+    // STRING: the string is a C string; GLOBAL: the global is constant
+    bool flag;
+    // INT: the value; FLOAT: the bit pattern
+    llvm::APInt value;
+    // FLOAT: the semantics of the value
+    const llvm::fltSemantics* sem;
+    // STRING: the (interned) data; GLOBAL: the (interned) name
+    llvm::StringRef name;
+
   public:
     PrevirtType();
-    PrevirtType(const proto::PrevirtType&);
     static PrevirtType
     abstract(const llvm::Value* const);
     static PrevirtType
     unknown();
 
   public:
-    PrevirtType& operator=(const PrevirtType&);
     bool operator!=(const PrevirtType&) const;
     bool operator==(const PrevirtType&) const;
 
+    // Least upper bound in the lattice: the type itself if both are
+    // equal, unknown otherwise.
+    static PrevirtType
+    join(const PrevirtType&, const PrevirtType&);
+
   public:
     int refines(const llvm::Value* const) const;
     llvm::Value* concretize(llvm::Module&, llvm::Type*) const;
@@ -81,10 +113,36 @@ namespace previrt {
     bool isUnknown() const;
     std::string to_string() const;
 
+    // Append a canonical encoding of the type to out. Two types are
+    // equal iff their encodings are, and the encoding of a sequence of
+    // types is the concatenation of their encodings.
+    void encode(std::string& out) const;
+
+    // Append to out the encodings of the concrete types that may
+    // refine val exactly (a superset of them).
+    static void
+    encodeMatches(const llvm::Value* const val, std::vector<std::string>& out);
+
   public:
+    // Return the function of the module that compares two values of
+    // this type (created on the first use). There is no state outside
+    // the module, so different modules can be used concurrently.
     llvm::Function*
     getEqualityFunction(llvm::Module*) const;
 
+  public:
+    // Raw access to the representation (used by the mapped interface
+    // format). Float semantics are given by their proto::FloatSemantics
+    // code.
+    Kind getKind() const;
+    bool getFlag() const;
+    const llvm::APInt& getValue() const;
+    unsigned getSemanticsCode() const;
+    llvm::StringRef getName() const;
+    static PrevirtType
+    get(Kind kind, bool flag, const llvm::APInt& value, unsigned sem,
+        llvm::StringRef name);
+
   public:
     FRIEND_SERIALIZERS(PrevirtType, proto::PrevirtType)
   };
@@ -0,0 +1,199 @@
+//
+// OCCAM
+//
+// Copyright (c) 2011-2020, SRI International
+//
+//  All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of SRI International nor the names of its contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#pragma once
+
+#include "PrevirtualizeInterfaces.h"
+#include "SpecializationPolicy.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace llvm
+{
+  class Module;
+  class CallGraph;
+}
+
+/*
+ * Entry points of the previrtualization passes.
+ *
+ * The passes registered in libprevirt (Pinterface, Pinternalize,
+ * Pspecialize and Prewrite) are thin wrappers that read/write the
+ * interface files and call these functions. They can be also called
+ * directly on modules that are already in memory (e.g., occam-slash).
+ *
+ * The entry points do not keep any state outside of their arguments,
+ * and their options are given explicitly, so a host can run them
+ * concurrently on modules that live in different LLVMContexts. The
+ * overloads without options read them from the command line.
+ */
+namespace previrt
+{
+  class SpecializationBudget;
+
+  struct MinimizeOptions {
+    // names that are never internalized
+    std::set<std::string> keepExternal;
+    // maximum number of rounds of global DCE
+    unsigned fixpointThreshold;
+
+    MinimizeOptions() : fixpointThreshold(5) {}
+  };
+
+  struct SpecializeOptions {
+    SpecializationPolicyType policy;
+    // maximum number of copies of a function for the bounded policy
+    unsigned maxBounded;
+    // minimum estimated savings in percent for the profitable policy
+    unsigned profitRatio;
+    // instructions that all the specializations of the module may
+    // add, in percent of its size (0 for no limit). It is kept in the
+    // module metadata across runs.
+    unsigned budget;
+    // if not null, used instead of the budget of the module (e.g.,
+    // the budget of the whole program)
+    SpecializationBudget* sharedBudget;
+    // with a profile, only the call sites (Ppeval) or the functions
+    // (Pspecialize) that run at least this percent as often as the
+    // hottest function are specialized
+    unsigned hotPercent;
+    // fold the specializations that are structurally identical
+    bool merge;
+    // The rest are used by intra-module specialization only:
+    // optimize the new functions
+    bool optimize;
+    // maximum number of rounds over the new functions (0 for no limit)
+    unsigned maxRounds;
+    // maximum code growth in percent (0 for no limit)
+    unsigned maxGrowth;
+
+    SpecializeOptions()
+      : policy(SpecializationPolicyType::NONREC), maxBounded(5),
+	profitRatio(10), budget(0), sharedBudget(nullptr),
+	hotPercent(1), merge(true), optimize(false), maxRounds(10), maxGrowth(0) {}
+  };
+
+  /*
+   * The options given on the command line to Pinternalize
+   * (-Pkeep-external, ...), Pspecialize (-Pspecialize-policy, ...)
+   * and Ppeval (-Ppeval-policy, ...).
+   */
+  MinimizeOptions getMinimizeOptions();
+  SpecializeOptions getSpecializeOptions();
+  SpecializeOptions getPartialEvalOptions();
+
+  /*
+   * Compute the external dependencies of M and add them to out.  If
+   * entries is null then all non-internal and address-taken
+   * functions are considered entry points.
+   */
+  void GatherInterface(llvm::Module& M, llvm::CallGraph& cg,
+		       const ComponentInterface* entries,
+		       ComponentInterface& out);
+
+  /*
+   * Compute the interface of the program formed by modules (i.e.,
+   * the closure of GatherInterface across modules) starting from the
+   * calls in entries. Each module is traversed at most once.
+   */
+  void GatherDeepInterface(const std::vector<llvm::Module*>& modules,
+			   const ComponentInterface& entries,
+			   ComponentInterface& out);
+
+  /*
+   * The maximum number of calls per function that Pinterface keeps
+   * in the interfaces it writes (-Pinterface-max-calls, 0 for no
+   * limit). See ComponentInterface::compact.
+   */
+  unsigned getInterfaceMaxCalls();
+
+  /*
+   * Remove all code from M that is not necessary to implement I.
+   */
+  bool MinimizeComponent(llvm::Module& M, const ComponentInterface& I,
+			 const MinimizeOptions& options);
+  bool MinimizeComponent(llvm::Module& M, const ComponentInterface& I);
+
+  /*
+   * Specialize the functions defined in M wrt the calls in the
+   * interface of T using the policy given by options. The new
+   * functions are added to M and the rewrites are recorded in T.
+   */
+  bool SpecializeComponent(llvm::Module& M, ComponentInterfaceTransform& T,
+			   llvm::CallGraph& cg, const SpecializeOptions& options);
+  bool SpecializeComponent(llvm::Module& M, ComponentInterfaceTransform& T,
+			   llvm::CallGraph& cg);
+
+  /*
+   * Same as SpecializeComponent for each modules[i] wrt transforms[i]
+   * but the calls of all the modules are ranked together and draw
+   * from budget.
+   */
+  bool SpecializeComponents(const std::vector<llvm::Module*>& modules,
+			    const std::vector<ComponentInterfaceTransform*>& transforms,
+			    const std::vector<llvm::CallGraph*>& cgs,
+			    const SpecializeOptions& options,
+			    SpecializationBudget& budget);
+
+  /*
+   * Specialize the calls to internal functions of M wrt their
+   * constant arguments (intra-module specialization, as Ppeval). The
+   * new functions are specialized in turn, in rounds, until no more
+   * are created or a limit of options is reached.
+   */
+  struct IntraSpecializeStats {
+    unsigned rounds;
+    // new functions
+    unsigned clones;
+    // call sites rewritten and the functions that contain them
+    unsigned rewritten;
+    unsigned callers;
+    // a limit stopped the rounds before no more functions were created
+    bool stopped;
+
+    IntraSpecializeStats()
+      : rounds(0), clones(0), rewritten(0), callers(0), stopped(false) {}
+  };
+
+  bool SpecializeIntraComponent(llvm::Module& M, llvm::CallGraph& cg,
+				const SpecializeOptions& options,
+				IntraSpecializeStats* stats = nullptr);
+
+  /*
+   * Rewrite the callsites of M according to T.
+   */
+  bool TransformComponent(llvm::Module& M, ComponentInterfaceTransform& T);
+}
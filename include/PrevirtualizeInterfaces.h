@@ -81,6 +81,16 @@ namespace previrt
     llvm::StringMap<std::vector<CallInfo*> > calls;
     std::set<std::string> references;
 
+  private:
+    // For each function, the position in calls of the call with the
+    // given (canonically encoded) arguments.
+    llvm::StringMap<llvm::StringMap<unsigned> > index;
+
+    CallInfo* lookup(llvm::StringRef f, const std::string& key) const;
+    CallInfo* lookupCovering(llvm::StringRef f,
+                             const std::vector<PrevirtType>& args) const;
+    void insert(llvm::StringRef f, const std::string& key, CallInfo* info);
+
   public:
     ComponentInterface();
     virtual ~ComponentInterface();
@@ -96,6 +106,17 @@ namespace previrt
 
     CallInfo* getOrCreateCall(FunctionHandle f, const std::vector<PrevirtType>& args);
 
+    // merge other into this interface. Return true if new calls or
+    // references were added.
+    bool join(const ComponentInterface& other);
+
+    // Bound the number of calls recorded for each function by limit:
+    // keep the limit-1 most frequent ones and fold the others into the
+    // join of their arguments (one call per arity). Return the number
+    // of calls that were folded. Calls are deleted, so this must not be
+    // used on the interface of a transform.
+    unsigned compact(unsigned limit);
+
     void dump() const;
     
   public:
@@ -132,6 +153,8 @@ namespace previrt
     FRIEND_SERIALIZERS(CallRewrite, proto::CallRewrite)
   };
 
+  class RewriteMatcher;
+
   class ComponentInterfaceTransform {
   public:
     typedef std::map<const CallInfo* const , const CallRewrite> CMap;
@@ -142,6 +165,11 @@ namespace previrt
     FMap rewrites;
     bool ownsIface;
 
+  private:
+    // For each function, the calls of the interface compiled into a
+    // decision trie over their arguments.
+    std::map<FunctionHandle, RewriteMatcher*> matchers;
+
   public:
     ComponentInterfaceTransform();
     ComponentInterfaceTransform(ComponentInterface*);
@@ -152,6 +180,15 @@ namespace previrt
 		 const std::vector<unsigned>&);
     void rewrite(FunctionHandle, const CallInfo* const , const CallRewrite&);
 
+    // merge the rewrites of other into this transform
+    void join(const ComponentInterfaceTransform& other);
+
+    // make the rewrites to the function from call to instead
+    void retarget(FunctionHandle from, FunctionHandle to);
+
+    // (re)build the matchers of the functions whose calls changed
+    void compile();
+
     void dump() const;
 
   public:
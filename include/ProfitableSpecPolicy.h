@@ -0,0 +1,86 @@
+//
+// OCCAM
+//
+// Copyright (c) 2020, SRI International
+//
+//  All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of SRI International nor the names of its contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include "SpecializationPolicy.h"
+
+#include <memory>
+
+namespace previrt {
+  /* 
+   * This policy is actually a "functor" policy (i.e., it takes as
+   * argument another policy p).
+   *
+   * Allow a new (specialized) copy of a function if p agrees and the
+   * constant arguments are expected to simplify enough of the
+   * function: the instructions that fold, the blocks that become
+   * unreachable and the loops whose trip count becomes constant must
+   * be at least m_ratio percent of the size of the function.
+  */
+  class ProfitableSpecPolicy : public SpecializationPolicy {
+    std::unique_ptr<SpecializationPolicy> m_subpolicy;
+    const unsigned m_ratio;
+
+    bool isProfitable(const llvm::Function& F,
+		      const std::vector<llvm::Constant*>& args) const;
+    
+  public:
+
+    ProfitableSpecPolicy(std::unique_ptr<SpecializationPolicy> subpolicy,
+			 unsigned ratio);
+
+    virtual ~ProfitableSpecPolicy() = default;
+
+    virtual bool intraSpecializeOn(llvm::CallSite CS,
+				   std::vector<llvm::Value*>& marks) override;
+    
+    virtual bool interSpecializeOn(const llvm::Function& F,
+				   const std::vector<PrevirtType>& args,
+				   const ComponentInterface& interface,
+				   llvm::SmallBitVector& marks) override;
+
+    // Estimate the number of instructions of F that are removed if
+    // its i-th argument is replaced with args[i] (when not null).
+    static unsigned estimateSavings(const llvm::Function& F,
+				    const std::vector<llvm::Constant*>& args);
+
+    // Same for the marked arguments of a call in an interface. Only
+    // integers, floats and nulls are propagated since strings and
+    // globals would have to be added to the module.
+    static unsigned estimateSavings(const llvm::Function& F,
+				    const std::vector<PrevirtType>& args,
+				    const llvm::SmallBitVector& marks);
+  };
+
+} // end namespace
@@ -0,0 +1,109 @@
+//
+// OCCAM
+//
+// Copyright (c) 2020, SRI International
+//
+//  All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of SRI International nor the names of its contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace llvm {
+  class Module;
+}
+
+namespace previrt {
+  /*
+   * Number of instructions that specialization may add to a module.
+   *
+   * The budget is fixed the first time the module is specialized, as
+   * a percentage of its size, and it is kept in the module metadata
+   * (!previrt.budget) together with the instructions already
+   * spent. Later runs of Ppeval and Pspecialize on the module (e.g.,
+   * the iterations of slash) draw from the same budget.
+   *
+   * A budget can also be shared by all the modules of a program
+   * (occam-slash) so that the best specializations of the program go
+   * first, whatever module they are in.
+   */
+  class SpecializationBudget {
+    // null for the budget of a program
+    llvm::Module* m_M;
+    // 0 if there is no limit
+    uint64_t m_total;
+    uint64_t m_spent;
+    
+  public:
+
+    struct Candidate {
+      // number of instructions added by the specialization
+      uint64_t cost;
+      // estimated number of instructions removed by the specialization
+      uint64_t benefit;
+      // position of the candidate in the caller's list
+      unsigned id;
+    };
+    
+    // Read the budget of M or, if M has none, allocate percent% of
+    // its size (no limit if percent is 0).
+    SpecializationBudget(llvm::Module& M, unsigned percent);
+
+    // The sum of the budgets of the modules. It is not saved in their
+    // metadata.
+    SpecializationBudget(const std::vector<llvm::Module*>& modules,
+			 unsigned percent);
+
+    bool isLimited() const {
+      return m_total > 0;
+    }
+
+    uint64_t total() const {
+      return m_total;
+    }
+
+    uint64_t spent() const {
+      return m_spent;
+    }
+    
+    bool canAfford(uint64_t cost) const;
+
+    void spend(uint64_t cost);
+
+    // Write the budget in the metadata of the module (nothing for the
+    // budget of a program).
+    void save() const;
+
+    // Sort candidates by decreasing benefit per instruction. Ties keep
+    // their order.
+    static void rank(std::vector<Candidate>& candidates);
+  };
+  
+} // end namespace
@@ -58,7 +58,9 @@ namespace previrt {
     AGGRESSIVE,   // always specialize
     BOUNDED,      // always specialize up to certain threshold
     ONLY_ONCE,    // specialize if function called only once
-    NONREC        // always specialize if function is non-recursive
+    NONREC,       // always specialize if function is non-recursive
+    PROFITABLE    // specialize if function is non-recursive and the
+                  // constant arguments simplify enough of it
   };
   
   class SpecializationPolicy {
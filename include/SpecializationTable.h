@@ -43,7 +43,9 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallBitVector.h"
+#include "llvm/Support/Allocator.h"
 
+#include <unordered_map>
 #include <vector>
 
 namespace llvm
@@ -55,6 +57,14 @@ namespace llvm
 
 namespace previrt
 {
+  /*
+   * The specializations of the functions of a module.
+   *
+   * Every specialization is also recorded in the module metadata
+   * (!previrt::specializations) and the table is loaded from it, so
+   * later runs of Ppeval and Pspecialize on the module reuse the
+   * existing copies.
+   */
   class SpecializationTable
   {
   public:
@@ -67,15 +77,25 @@ namespace previrt
       std::vector<Specialization*> children;
 
       // Return true if l is more specific than r
-      static bool refines(SpecScheme l, SpecScheme r);
+      static bool refines(const SpecScheme& l, const SpecScheme& r);
     };
 
   private:
     
     typedef llvm::DenseMap<llvm::Function*,Specialization*> SpecTable;
     mutable SpecTable specialized;
+    // owns all the nodes of the table
+    mutable llvm::SpecificBumpPtrAllocator<Specialization> arena;
+    // children by a hash of their parent and scheme
+    std::unordered_multimap<size_t, Specialization*> byScheme;
+    // children of a node with a given constant at a given position
+    typedef std::pair<const Specialization*, std::pair<unsigned, llvm::Value*> > ArgKey;
+    llvm::DenseMap<ArgKey, std::vector<Specialization*> > byArg;
     llvm::Module* module;
 
+    // Create the node of a specialization of parent
+    Specialization* insert(llvm::Function* parent, const SpecScheme&, llvm::Function* handle);
+
   public:
     
     SpecializationTable();
@@ -86,16 +106,29 @@ namespace previrt
       
     void initialize(llvm::Module*);
       
-    void getSpecializations(llvm::Function*, SpecScheme,
+    // Add to the result the specializations of f that refine scheme
+    void getSpecializations(llvm::Function*, const SpecScheme&,
 			    std::vector<const Specialization*>&) const;
+
+    // Return the specialization of f with exactly the given scheme
+    const Specialization* lookupSpecialization(llvm::Function*,
+					       const SpecScheme&) const;
     
-    bool addSpecialization(llvm::Function*, SpecScheme, llvm::Function*, bool record=true);
+    // Add a specialization and, if record, write it in the metadata
+    bool addSpecialization(llvm::Function*, const SpecScheme&, llvm::Function*, bool record=true);
 
     const Specialization* getPrincipalSpecialization(llvm::Function*) const;
       
     Specialization* getSpecialization(llvm::Function*) const;
     
-    const llvm::Function* getPrincipalFunction(const llvm::Function*) const;
+    // The specialization from is replaced by the identical to
+    void replaceSpecialization(llvm::Function* from, llvm::Function* to);
+
+    // Return true if f is a specialization of another function
+    bool isSpecialization(const llvm::Function* f) const;
+
+    // Return the function that f was (transitively) specialized from
+    const llvm::Function* getPrincipalFunction(const llvm::Function* f) const;
     
   };
 }
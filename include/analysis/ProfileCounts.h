@@ -0,0 +1,72 @@
+#pragma once
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace llvm {
+  class BasicBlock;
+  class Function;
+  class Instruction;
+  class Module;
+}
+
+namespace previrt {
+namespace analysis {
+
+/*
+  Execution counts of the code of a module.
+
+  They are read from the !prof metadata: function entry counts and
+  branch weights, and value profiles for the targets of indirect
+  calls. The metadata is attached either from an LLVM .profdata file
+  (opt -pgo-instr-use) or from the profile of a run of the OCCAM
+  interpreter (Pprofile-use).
+
+  The counts of the blocks of a function are computed the first time
+  they are queried. Call invalidate if its CFG changes afterwards.
+ */
+class ProfileCounts {
+  struct FunctionCounts;
+
+  // the largest function entry count, 0 if the module has no profile
+  uint64_t m_max;
+  llvm::DenseMap<const llvm::Function*, std::unique_ptr<FunctionCounts>> m_counts;
+  // functions by the hash of their PGO name, used in value profiles
+  llvm::DenseMap<uint64_t, const llvm::Function*> m_by_hash;
+
+  void addPGOName(llvm::StringRef name, const llvm::Function &F);
+
+  FunctionCounts &getCounts(const llvm::Function &F);
+  
+ public:
+  
+  explicit ProfileCounts(const llvm::Module &M);
+
+  ~ProfileCounts();
+
+  bool hasProfile() const { return m_max > 0; }
+
+  // Number of executions of BB, if known.
+  llvm::Optional<uint64_t> getCount(const llvm::BasicBlock &BB);
+
+  // Whether I runs at least percent% as often as the hottest function
+  // of the module. Code without counts is hot.
+  bool isHot(const llvm::Instruction &I, unsigned percent);
+
+  // Same for the entry of F.
+  bool isHot(const llvm::Function &F, unsigned percent) const;
+
+  // Add to targets the callees observed at the indirect call I and
+  // how many times each was called.
+  void getCallTargets(const llvm::Instruction &I,
+		      llvm::DenseMap<const llvm::Function*, uint64_t> &targets) const;
+
+  // Forget the block counts of F.
+  void invalidate(const llvm::Function &F);
+};
+
+} // end namespace analysis
+} // end namespace previrt
@@ -203,6 +203,10 @@ private:
   // Worklist of call sites to transform
   llvm::SmallVector<llvm::Instruction *, 32> m_worklist;
 
+  // Number of calls to each target observed at the call sites of the
+  // worklist, if the module has a profile
+  llvm::DenseMap<const llvm::Function *, uint64_t> m_target_counts;
+
   /// turn the indirect call-site into a direct one
   void mkDirectCall(llvm::CallSite CS, CallSiteResolver *CSR);
 
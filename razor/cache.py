@@ -0,0 +1,214 @@
+"""
+ OCCAM
+
+ Copyright (c) 2011-2020, SRI International
+
+  All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+ * Neither the name of SRI International nor the names of its contributors may
+   be used to endorse or promote products derived from this software without
+   specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+ Persistent, content-addressed cache of the results of opt and
+ occam-slash calls.
+
+ A call is identified by the program, its arguments, and the contents
+ of every file named on the command line (bitcode, interfaces, rewrite
+ files, and the libraries loaded with -load, so a rebuilt libprevirt
+ invalidates its entries). The names of the output files are not part
+ of the key: they are replaced by their position.
+
+ Each entry is a directory holding the output files and a small json
+ record with the log of the call. Entries are evicted least recently
+ used first once the cache grows beyond its size bound.
+"""
+import hashlib
+import json
+import logging
+import os
+import shutil
+import tempfile
+import threading
+
+from . import provenance
+
+# set by slash.driver_config
+cache_dir = None
+
+# set by slash.driver_config
+max_size = 1024 * 1024 * 1024
+
+# options whose value is a file written by the call
+OUTPUT_OPTIONS = ['-o', '--o',
+                  '-Pinterface-output',
+                  '-Pspecialize-output',
+                  '-Pslash-output',
+                  '-profile-outfile',
+                  '--Pcost-benefit-output']
+
+# programs whose results only depend on their command line
+CACHEABLE = ['opt', 'seaopt', 'occam-slash']
+
+_digests = provenance.Digests()
+_lock = threading.Lock()
+
+def enabled():
+    return cache_dir is not None
+
+def _cacheable(prog):
+    base = os.path.basename(prog)
+    return any([base == x or base.startswith(x + '-') for x in CACHEABLE])
+
+def _split(arg):
+    """ split -opt=value into (-opt, value)
+    """
+    if arg.startswith('-') and '=' in arg:
+        (opt, val) = arg.split('=', 1)
+        return (opt, val)
+    return (arg, None)
+
+class Key(object):
+    def __init__(self, digest, outputs):
+        self.digest = digest
+        self.outputs = outputs
+
+    def path(self):
+        return os.path.join(cache_dir, self.digest[:2], self.digest)
+
+def key(prog, args):
+    """ the key of the call, or None if it should not be cached.
+    """
+    if not enabled() or not _cacheable(prog):
+        return None
+    h = hashlib.sha1()
+    h.update(os.path.basename(prog))
+    if os.path.isfile(prog):
+        h.update(_digests.get(prog))
+    outputs = []
+    is_output = False
+    for arg in args:
+        if is_output:
+            outputs.append(arg)
+            h.update('\0<output>')
+            is_output = False
+            continue
+        (opt, val) = _split(arg)
+        if opt in OUTPUT_OPTIONS:
+            if val is None:
+                is_output = True
+                h.update('\0' + opt)
+            else:
+                outputs.append(val)
+                h.update('\0' + opt + '=<output>')
+        elif val is not None and os.path.isfile(val):
+            h.update('\0' + opt + '=@' + _digests.get(val))
+        elif os.path.isfile(arg):
+            h.update('\0@' + _digests.get(arg))
+        else:
+            h.update('\0' + arg)
+    if is_output:
+        return None
+    outputs = [o if o != '/dev/null' else None for o in outputs]
+    return Key(h.hexdigest(), outputs)
+
+def fetch(k):
+    """ copy the cached outputs of k into place and return its log,
+        or None if k is not in the cache.
+    """
+    d = k.path()
+    try:
+        with open(os.path.join(d, 'entry.json')) as fd:
+            entry = json.load(fd)
+        if entry['outputs'] != len(k.outputs):
+            return None
+        for (i, o) in enumerate(k.outputs):
+            if o is not None:
+                shutil.copyfile(os.path.join(d, 'out.{0}'.format(i)), o)
+        os.utime(os.path.join(d, 'entry.json'), None)
+    except (IOError, OSError, ValueError, KeyError):
+        return None
+    logging.getLogger().info('CACHED: %s\n', k.digest)
+    return entry['log']
+
+def store(k, log=''):
+    """ record the outputs of a successful call.
+    """
+    d = k.path()
+    if os.path.exists(d):
+        return
+    parent = os.path.dirname(d)
+    try:
+        if not os.path.isdir(parent):
+            os.makedirs(parent)
+        tmp = tempfile.mkdtemp(dir=parent)
+    except OSError:
+        return
+    try:
+        for (i, o) in enumerate(k.outputs):
+            if o is not None:
+                shutil.copyfile(o, os.path.join(tmp, 'out.{0}'.format(i)))
+        with open(os.path.join(tmp, 'entry.json'), 'w') as fd:
+            json.dump({'outputs' : len(k.outputs), 'log' : log}, fd)
+        os.rename(tmp, d)
+    except (IOError, OSError):
+        # another slash stored the same entry, or the outputs were
+        # removed by the caller: either way nothing is lost.
+        shutil.rmtree(tmp, True)
+        return
+    evict()
+
+def _size(d):
+    return sum([os.path.getsize(os.path.join(d, f)) for f in os.listdir(d)])
+
+def evict():
+    """ remove the least recently used entries until the cache fits
+        in max_size bytes.
+    """
+    with _lock:
+        entries = []
+        total = 0
+        for sub in os.listdir(cache_dir):
+            subdir = os.path.join(cache_dir, sub)
+            if not os.path.isdir(subdir):
+                continue
+            for e in os.listdir(subdir):
+                d = os.path.join(subdir, e)
+                meta = os.path.join(d, 'entry.json')
+                try:
+                    size = _size(d)
+                    entries.append((os.path.getmtime(meta), size, d))
+                except OSError:
+                    continue
+                total += size
+        entries.sort()
+        for (_, size, d) in entries:
+            if total <= max_size:
+                break
+            shutil.rmtree(d, True)
+            total -= size
+            try:
+                os.rmdir(os.path.dirname(d))
+            except OSError:
+                pass
@@ -55,8 +55,9 @@ __libext = libExtension()
 class ConfigObj(object):
     """All access to the environment comes through this class.
     """
-    def  __init__(self, libfile, seadsalib, llvmdsalib, llpelibs):
+    def  __init__(self, libfile, seadsalib, llvmdsalib, llpelibs, slashtool):
         self._occamlib = libfile
+        self._slashtool = slashtool
         self._seadsalib = seadsalib
         self._llvmdsalib = llvmdsalib
         self._llpelibs = llpelibs
@@ -84,6 +85,11 @@ class ConfigObj(object):
         """
         return self._occamlib
 
+    def get_occam_slash(self):
+        """ Returns the path to the occam-slash executable.
+        """
+        return self._slashtool
+
     def get_sea_dsalib(self):
         """ Returns the path to the SeaHorn DSA library.
         """
@@ -116,6 +122,16 @@ def get_occamlib_path():
     sys.stderr.write('Unsupported platform: {0}\n'.format(__system))
     return None
 
+def get_occam_slash_path():
+    """ Deduces the full path to the occam-slash executable.
+        It is installed next to the occam library.
+    """
+    home = os.getenv('OCCAM_HOME')
+    if home is None:
+        sys.stderr.write('OCCAM_HOME not set!\n')
+        return None
+    return os.path.join(home, 'lib', 'occam-slash')
+
 def get_sea_dsalib_path():
     """ Deduces the full path to the SeaHorn DSA shared/dynamic library.
     """
@@ -167,13 +183,19 @@ def get_logfile():
 CFG = ConfigObj(get_occamlib_path(), \
                 get_sea_dsalib_path(), \
                 get_llvm_dsalib_path(), \
-                get_llpelibs_paths())
+                get_llpelibs_paths(), \
+                get_occam_slash_path())
 
 def get_occamlib():
     """ Returns the path to the occam shared/dynamic library.
     """
     return CFG.get_occamlib()
 
+def get_occam_slash():
+    """ Returns the path to the occam-slash executable.
+    """
+    return CFG.get_occam_slash()
+
 def get_sea_dsalib():
     """ Returns the path to the SeaHorn DSA shared/dynamic library.
     """
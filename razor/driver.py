@@ -34,6 +34,7 @@ import subprocess
 import logging
 import os.path
 
+from . import cache
 from . import config
 from . import echo
 from . import stringbuffer
@@ -88,6 +89,14 @@ def previrt_progress(fin, fout, args, output=None):
 
     log = logging.getLogger()
 
+    key = cache.key(prog, args)
+    if key is not None:
+        progress = cache.fetch(key)
+        if progress is not None:
+            if output != None:
+                output[0] = progress
+            return '...progress...' in progress
+
     sb = stringbuffer.StringBuffer()
 
     log.log(logging.INFO, 'EXECUTING: %s\n', ' '.join([prog] + args))
@@ -113,11 +122,17 @@ def previrt_progress(fin, fout, args, output=None):
                              {'cmd'  : ' '.join(args),
                               'code' : retcode,
                               'progress' : progress})
+    if key is not None and retcode == 0:
+        cache.store(key, progress)
     if output != None:
         output[0] = progress
     return '...progress...' in progress
 
 
+def occam_slash(args, **opts):
+    args = opt_debug_cmds + args
+    return run(config.get_occam_slash(), args, **opts)
+
 def linker(fin, fout, args):
     args = [fin, '-o', fout] + args
     return run('clang++', args)
@@ -153,6 +168,12 @@ def run(prog, args, sb=None, fail_on_error=True):
 
     report(prog, args)
 
+    key = None
+    if outfp == subprocess.PIPE and sb is None:
+        key = cache.key(prog, args)
+    if key is not None and cache.fetch(key) is not None:
+        return 0
+
     log.log(logging.INFO, 'EXECUTING: %s\n', ' '.join([prog] + args))
 
     proc = subprocess.Popen([prog] + args,
@@ -173,6 +194,9 @@ def run(prog, args, sb=None, fail_on_error=True):
     log.log(logging.INFO, 'EXECUTED: %(cmd)s WHICH RETURNED %(code)d\n',
             {'cmd'  : ' '.join([prog] + args), 'code' : retcode })
 
+    if key is not None and retcode == 0:
+        cache.store(key)
+
     if fail_on_error and retcode != 0:
         ex = ReturnCode(retcode, [prog] + args, proc)
         logging.getLogger().error('ERROR: %s', ex)
@@ -33,6 +33,7 @@
 
 import sys
 import os
+import re
 import tempfile
 import shutil
 
@@ -49,25 +50,54 @@ from . import pool
 from . import utils  
 
 
-def interface(input_file, output_file, wrt):
+# Ppeval cleans up the functions that it changes. If it reaches its
+# own fixpoint after changing at most this many functions then peval
+# does not run the whole-module optimizer again to look for more.
+peval_reoptimize_threshold = 8
+
+def _peval_changed(log):
+    """ the number of functions changed by -Ppeval according to its
+        log, or None if it did not reach its fixpoint.
+    """
+    if 'Stopped intra-module specialization' in log:
+        return None
+    m = re.search(r'Intra-module specialization: \d+ rounds, (\d+) new functions, '
+                  r'\d+ call sites rewritten in (\d+) functions', log)
+    if m is None:
+        return None
+    return int(m.group(1)) + int(m.group(2))
+
+def interface(input_file, output_file, wrt, mapped=False):
     """ computing the interfaces.
+        If mapped then the output is written in the binary format
+        that libprevirt queries in place (razor cannot parse it).
     """
     args = ['-Pinterface', '-Pinterface-output', output_file]
     args += driver.all_args('-Pinterface-entry', wrt)
+    if mapped:
+        args += ['-Pmapped-output']
     return driver.previrt(input_file, '/dev/null', args)
 
 def specialize(input_file, output_file, rewrite_file, interfaces, \
-               policy, max_bounded):
+               policy, max_bounded, mapped=False, budget=None):
     """ inter module specialization.
+        If mapped then the rewrite file is written in the binary format
+        that libprevirt queries in place (razor cannot parse it).
+        budget is the code growth allowed to all the specializations
+        of the module, in percent of its size.
     """
     args = ['-Pspecialize']
     if not rewrite_file is None:
         args += ['-Pspecialize-output', rewrite_file]
+        if mapped:
+            args += ['-Pmapped-output']
     args += driver.all_args('-Pspecialize-input', interfaces)
     if policy <> 'none':
         args += ['-Pspecialize-policy={0}'.format(policy)]
     if policy == 'bounded':
         args += ['-Pspecialize-max-bounded={0}'.format(max_bounded)]
+    if budget is not None:
+        args += ['-Pspecialize-budget={0}'.format(budget)]
     if output_file is None:
         output_file = '/dev/null'
     return driver.previrt(input_file, output_file, args)
@@ -109,15 +139,11 @@ def strip(input_file, output_file):
     args += ['-strip', '-strip-dead-prototypes']             
     return driver.run(config.get_llvm_tool('opt'), args)
 
-def devirt(devirt_method, input_file, output_file):
-    """ resolve indirect function calls
+def devirt_options(devirt_method):
+    """ options of -Pdevirt for the given method
     """
-    assert(devirt_method <> 'none')
-
-    args = []
-
-    args += [ '-Pdevirt'
-            #, '-Presolve-incomplete-calls=true'
+    args = [
+            #'-Presolve-incomplete-calls=true'
             #, '-Pmax-num-targets=15'
     ]
 
@@ -128,7 +154,21 @@ def devirt(devirt_method, input_file, output_file):
         args += ['-Pdevirt-with-seadsa'
                  , '-sea-dsa-type-aware=true'
         ]
-        
+    return args
+
+def ipdse_options():
+    """ options of the sea-dsa based inter-procedural dead store elimination
+    """
+    ###Context-insensitive sea-dsa  
+    return ['-sea-dsa=ci', '-horn-sea-dsa-local-mod', '-ip-dse-max-def-use=25']
+
+def devirt(devirt_method, input_file, output_file):
+    """ resolve indirect function calls
+    """
+    assert(devirt_method <> 'none')
+
+    args = ['-Pdevirt'] + devirt_options(devirt_method)
+
     retcode = driver.previrt_progress(input_file, output_file, args)
     if retcode != 0:
         return retcode
@@ -195,7 +235,8 @@ def peval(input_file, output_file, \
           policy, max_bounded, \
           devirt_method, \
           force_inline_bounce, force_inline_spec, \
-          use_llpe, use_ipdse, use_ai_dce, log=None):
+          use_llpe, use_ipdse, use_ai_dce, log=None, budget=None,
+          ipdse_shadow_mem=False):
     """ intra module specialization/optimization
     """
     opt = tempfile.NamedTemporaryFile(suffix='.bc', delete=False)
@@ -280,14 +321,14 @@ def peval(input_file, output_file, \
         
         ## 2. dead store elimination based on sea-dsa (improve
         ##    precision of sccp)
-        passes += [
-                   ###Context-insensitive sea-dsa  
-                   '-sea-dsa=ci', '-horn-sea-dsa-local-mod',
-                   ##Inter-procedural dead store elimination
-                   '-ip-dse', '-ip-dse-max-def-use=25']
+        ##Inter-procedural dead store elimination
+        passes += ['-ip-dse'] + ipdse_options()
         
         ## 3. perform IPSCCP
         passes += ['-Pipsccp']
+        if ipdse_shadow_mem:
+            ## follow the shadow.mem def-use chains of sea-dsa
+            passes += ['-Pipsccp-shadow-mem']
         ## 4. cleanup after IPSCCP
         passes += ['-dce', '-globaldce']
         retcode = driver.previrt(done.name, tmp.name, passes)
@@ -340,6 +381,8 @@ def peval(input_file, output_file, \
             pass_args = ['-Ppeval', '-Ppeval-policy={0}'.format(policy), '-Ppeval-opt']
             if policy == 'bounded':
                 pass_args += ['-Ppeval-max-bounded={0}'.format(max_bounded)]
+            if budget is not None:
+                pass_args += ['-Ppeval-budget={0}'.format(budget)]
                 
             progress = driver.previrt_progress(opt.name, tmp.name, pass_args, output=out)
             sys.stderr.write("\tintra-module specialization finished\n")
@@ -349,6 +392,11 @@ def peval(input_file, output_file, \
             if progress:
                 if log is not None:
                     log.write(out[0])
+                changed = _peval_changed(out[0])
+                if changed is not None and changed <= peval_reoptimize_threshold:
+                    sys.stderr.write("\tskipped whole-module optimization: only "
+                                     "{0} functions changed\n".format(changed))
+                    break
             else:
                 shutil.copy(opt.name, done.name)
                 break
@@ -364,6 +412,50 @@ def peval(input_file, output_file, \
         pass
     return retcode
 
+def slash(input_files, output_files, entries, whitelist, \
+          opt_options, \
+          intra_policy, inter_policy, max_bounded, \
+          devirt_method, \
+          force_inline_bounce, force_inline_spec, \
+          use_ipdse, max_iterations, budget=None, ipdse_shadow_mem=False):
+    """ run the global fixpoint (interface, internalize, peval,
+        specialize, rewrite and sealing) in a single process
+    """
+    args = driver.all_args('-Pslash-output', output_files)
+    args += driver.all_args('-Pslash-entry', entries)
+    args += ['-Pslash-max-iterations={0}'.format(max_iterations)]
+    if whitelist is not None:
+        args += ['-Pkeep-external', whitelist]
+
+    def policy_name(policy):
+        return 'nospecialize' if policy == 'none' else policy
+
+    args += ['-Ppeval-policy={0}'.format(policy_name(intra_policy)), '-Ppeval-opt']
+    if intra_policy == 'bounded':
+        args += ['-Ppeval-max-bounded={0}'.format(max_bounded)]
+    args += ['-Pspecialize-policy={0}'.format(policy_name(inter_policy))]
+    if inter_policy == 'bounded':
+        args += ['-Pspecialize-max-bounded={0}'.format(max_bounded)]
+    if budget is not None:
+        args += ['-Ppeval-budget={0}'.format(budget),
+                 '-Pspecialize-budget={0}'.format(budget)]
+
+    if devirt_method <> 'none':
+        args += ['-Pslash-devirt'] + devirt_options(devirt_method)
+    if force_inline_bounce:
+        args += ['-Pslash-inline-bounce']
+    if force_inline_spec:
+        args += ['-Pslash-inline-spec']
+    if use_ipdse:
+        args += ['-Pslash-ipdse'] + ipdse_options()
+        if ipdse_shadow_mem:
+            args += ['-Pipsccp-shadow-mem']
+    args += ['-Pslash-reoptimize-threshold={0}'.format(peval_reoptimize_threshold)]
+
+    args += opt_options
+    args += input_files
+    return driver.occam_slash(args)
+
 def optimize(input_file, output_file, use_seaopt, extra_opts):
     """ Run opt -O3.
         The optimizer is tuned for code debloating and not necessarily
@@ -435,11 +527,21 @@ def specialize_program_args(input_file, output_file, args, filename=None, name=N
     if filename is None:
         os.unlink(arg_file)
 
-def config_prime(input_file, output_file, known_args, num_unknown_args):
+def profile_use(input_file, output_file, profdata):
+    """ attach the execution counts of an LLVM .profdata file
+        (function entry counts, branch weights and targets of indirect
+        calls) as profile metadata.
+    """
+    args = ['-pgo-instr-use', '-pgo-test-profile-file={0}'.format(profdata)]
+    return driver.previrt(input_file, output_file, args)
+
+def config_prime(input_file, output_file, known_args, num_unknown_args, profile=False):
     """ 
     Execute the program until a branch condition is unknown.
     known_args is a list of strings
     num_unknown_args is a non-negative number.
+    If profile then the execution counts of the run are attached as
+    profile metadata.
     """
     ## TODOX: find subset of -O1 that simplify loops for dominance queries
     args = ['-O1'] # '-loop-simplify', '-simplifycfg'
@@ -452,28 +554,23 @@ def config_prime(input_file, output_file, known_args, num_unknown_args):
             args.append('-Pconfig-prime-input-arg=\"{0}\"'.format(x))
         index += 1
     args.append('-Pconfig-prime-unknown-args={0}'.format(num_unknown_args))
+    if profile:
+        args.append('-Pconfig-prime-profile')
     driver.previrt(input_file, output_file, args)
     
 def deep(libs, ifaces):
     """ compute interfaces across modules.
+        The closure is computed by -Pdeep-interface in a single call to opt.
     """
     tf = tempfile.NamedTemporaryFile(suffix='.iface', delete=False)
     tf.close()
-    iface = inter.parseInterface(ifaces[0])
-    for i in ifaces[1:]:
-        inter.joinInterfaces(iface, inter.parseInterface(i))
-
-    inter.writeInterface(iface, tf.name)
 
-    progress = True
-    while progress:
-        progress = False
-        for l in libs:
-            interface(l, tf.name, [tf.name])
-            x = inter.parseInterface(tf.name)
-            progress = inter.joinInterfaces(iface, x) or progress
-            inter.writeInterface(iface, tf.name)
+    args = ['-Pinterface', '-Pdeep-interface', '-Pinterface-output', tf.name]
+    args += driver.all_args('-Pinterface-entry', ifaces)
+    args += driver.all_args('-Pdeep-interface-module', libs[1:])
+    driver.previrt(libs[0], '/dev/null', args)
 
+    iface = inter.parseInterface(tf.name)
     os.unlink(tf.name)
     return iface
 
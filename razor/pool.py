@@ -35,9 +35,12 @@
 
 """
 from Queue import Queue
+import multiprocessing
 import threading
 import traceback
+import time
 import sys
+import os
 
 class Worker(threading.Thread):
     """ A daemon worker thread.
@@ -53,55 +56,144 @@ class Worker(threading.Thread):
         """
         while True:
             f = self.queue.get(True)
+            if f is None:
+                break
             f()
 
 
+class JobFailed(Exception):
+    """ Raised by ThreadPool.map when a job raised an exception.
+    """
+    def __init__(self, desc, name):
+        Exception.__init__(self)
+        self.desc = desc
+        self.name = name
+
+    def __str__(self):
+        return "{0} failed on {1}".format(self.desc, self.name)
+
+
+def defaultCount():
+    """ The default number of workers: one per core.
+    """
+    try:
+        return multiprocessing.cpu_count()
+    except NotImplementedError:
+        return 1
+
+def jobFile(arg):
+    """ Returns the file a job works on or None.
+        Jobs are either versioned files or tuples containing one.
+    """
+    if isinstance(arg, (tuple, list)):
+        files = [jobFile(x) for x in arg if not isinstance(x, basestring)]
+        files = [x for x in files if x is not None]
+        if files:
+            return files[0]
+        names = [x for x in arg if isinstance(x, basestring)]
+        return names[0] if names else None
+    if isinstance(arg, basestring):
+        return arg
+    if hasattr(arg, 'get'):
+        return arg.get()
+    return None
+
+def jobSize(arg):
+    """ Returns the size of the file a job works on (0 if unknown).
+    """
+    fn = jobFile(arg)
+    if fn is not None and os.path.isfile(fn):
+        return os.path.getsize(fn)
+    return 0
+
+
 class ThreadPool(object):
     """ A pool of daemon worker threads.
     """
-    def __init__(self, count=3):
+    def __init__(self, count=None):
         """ Initializes a pool queue.
         """
         self.queue = Queue()
         self.workers = None
+        if count is None or count < 1:
+            count = defaultCount()
         self.count = count
 
     def _start(self):
         if self.workers is None:
-            self.workers = [Worker(self.queue)]
+            self.workers = [Worker(self.queue) for _ in range(0, self.count)]
             for w in self.workers:
                 w.start()
 
     def map(self, f, args):
+        """ Applies f to all args and returns the results in the same order.
+
+            The largest jobs (see jobSize) are started first.  If a
+            job fails then the jobs that have not started yet are
+            cancelled and JobFailed is raised once the running ones
+            have finished.
+        """
         self._start()
         result = [None for i in range(0, len(args))]
+        times = [None for i in range(0, len(args))]
+        names = [jobFile(a) or str(a) for a in args]
+        failed = []
+        lock = threading.Lock()
         sem = threading.Semaphore(0)
         def func(i):
             def rf():
                 try:
+                    with lock:
+                        if failed:
+                            # cancelled
+                            return
+                    start = time.time()
                     result[i] = f(args[i])
+                    times[i] = time.time() - start
                 except Exception:
                     seperator = '-' * 60
-                    print("Exception in worker for {0}:".format(f.func_doc))
-                    print(seperator)
-                    traceback.print_exc(file=sys.stderr)
-                    print(seperator)
-                    sys.exit(1)  #iam: was _exit; but are we really that low level?
+                    with lock:
+                        failed.append(i)
+                        sys.stderr.write("Exception in worker for {0} on {1}:\n".format(f.func_doc, names[i]))
+                        sys.stderr.write(seperator + '\n')
+                        traceback.print_exc(file=sys.stderr)
+                        sys.stderr.write(seperator + '\n')
                 finally:
                     sem.release()
             return rf
-        for i in range(0, len(args)):
+        sizes = [jobSize(a) for a in args]
+        order = sorted(range(0, len(args)), key=lambda i: sizes[i], reverse=True)
+        for i in order:
             self.queue.put(func(i))
         for _ in args:
             sem.acquire(True)
+        for i in order:
+            if times[i] is not None:
+                sys.stderr.write("\t{0:8.2f}s {1}\n".format(times[i], names[i]))
+        if failed:
+            cancelled = len([t for t in times if t is None]) - len(failed)
+            if cancelled > 0:
+                sys.stderr.write("\tcancelled {0} job(s)\n".format(cancelled))
+            raise JobFailed(f.func_doc, names[failed[0]])
         return result
 
     def shutdown(self):
-        pass
+        if self.workers is not None:
+            for _ in self.workers:
+                self.queue.put(None)
+            for w in self.workers:
+                w.join()
+            self.workers = None
 
-POOL = ThreadPool(3)
+POOL = None
 
-def getDefaultPool():
+def getDefaultPool(count=None):
+    """ Returns the default pool. It is created with count workers
+        (one per core if None) the first time this is called.
+    """
+    global POOL
+    if POOL is None:
+        POOL = ThreadPool(count)
     return POOL
 
 def InParallel(f, args, pool=None):
@@ -110,10 +202,12 @@ def InParallel(f, args, pool=None):
     sys.stderr.write("[%s] Starting %s...\n" % (dt, f.func_doc))
     if pool is None:
         pool = getDefaultPool()
+    start = time.time()
     result = pool.map(f, args)
-    sys.stderr.write("done\n")
+    sys.stderr.write("done (%.2fs)\n" % (time.time() - start))
     return result
 
 
 def shutdownDefaultPool():
-    POOL.shutdown()
+    if POOL is not None:
+        POOL.shutdown()
@@ -30,6 +30,11 @@
  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 """
+import hashlib
+import os
+import shutil
+import threading
+import time
 
 class VersionedFile(object):
     def __init__(self, base, suffix, digits=2):
@@ -68,3 +73,93 @@ class FileStream(object):
 
     def __len__(self):
         return len(self._versions)
+
+
+class Digests(object):
+    """
+    Content digests of files, recomputed only when the inode, the size
+    or the modification/change times of the file change.
+
+    A file modified within the resolution of the file system clock may
+    keep the same times, so the digest of a file modified less than a
+    second ago is never cached.
+    """
+    racy_window = 1.0
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        self._cache = {}
+
+    def get(self, path):
+        st = os.stat(path)
+        stamp = (st.st_ino, st.st_size, st.st_mtime, st.st_ctime,
+                 getattr(st, 'st_mtime_ns', None))
+        racy = time.time() - max(st.st_mtime, st.st_ctime) < self.racy_window
+        if not racy:
+            with self._lock:
+                entry = self._cache.get(path)
+                if entry is not None and entry[0] == stamp:
+                    return entry[1]
+        h = hashlib.sha1()
+        with open(path, 'rb') as fd:
+            for chunk in iter(lambda: fd.read(1 << 16), b''):
+                h.update(chunk)
+        d = h.hexdigest()
+        with self._lock:
+            if racy:
+                self._cache.pop(path, None)
+            else:
+                self._cache[path] = (stamp, d)
+        return d
+
+    def __call__(self, paths):
+        return tuple([self.get(p) for p in paths])
+
+class StageMemo(object):
+    """
+    Remembers, for each stage of the fixpoint and each module, the
+    outputs that the stage produced from inputs with the given digests.
+
+    A stage whose inputs are unchanged does not need to run again: its
+    outputs are the recorded ones.
+    """
+    def __init__(self, digests=None):
+        self._lock = threading.Lock()
+        self._table = {}
+        self.digests = Digests() if digests is None else digests
+        self.hits = 0
+        self.misses = 0
+
+    def lookup(self, stage, key, inputs):
+        """
+        Return (outputs, value) recorded for the inputs, or None.
+        """
+        ds = self.digests(inputs)
+        with self._lock:
+            entry = self._table.get((stage, key))
+        if entry is None or entry[0] != ds or \
+           not all([os.path.exists(f) for f in entry[1]]):
+            with self._lock:
+                self.misses += 1
+            return None
+        with self._lock:
+            self.hits += 1
+        return (entry[1], entry[2])
+
+    def record(self, stage, key, inputs, outputs, value=None):
+        ds = self.digests(inputs)
+        with self._lock:
+            self._table[(stage, key)] = (ds, list(outputs), value)
+
+    def restore(self, stream, cached, *ver):
+        """
+        Make the current version of stream hold the contents of cached.
+        A new version is only created if the contents differ.
+        """
+        cur = stream.get()
+        if os.path.exists(cur) and \
+           self.digests.get(cur) == self.digests.get(cached):
+            return cur
+        dst = stream.new(*ver)
+        shutil.copyfile(cached, dst)
+        return dst
@@ -48,6 +48,8 @@ from . import pool
 
 from . import driver
 
+from . import cache
+
 from . import config
 
 instructions = """slash has three modes of use:
@@ -77,10 +79,11 @@ instructions = """slash has three modes of use:
         --devirt=<type>            : Devirtualize indirect function calls 
                                      (<type> should be either none, dsa, sea_dsa or cha_dsa)
         --intra-spec-policy=<type> : Specialization policy for intramodule calls 
-                                     (<type> should be either none, aggressive, nonrec-aggressive, bounded, or onlyonce)
+                                     (<type> should be either none, aggressive, nonrec-aggressive, bounded, onlyonce, or profitable)
         --inter-spec-policy=<type> : Specialization policy for intermodule calls 
-                                     (<type> should be either none, aggressive, nonrec-aggressive, bounded, or onlyonce)
+                                     (<type> should be either none, aggressive, nonrec-aggressive, bounded, onlyonce, or profitable)
         --max-bounded-spec=N       : Maximum number of function specialization if spec policy is bounded
+        --spec-budget=N            : Maximum code growth of each module due to specialization, in percent of its size (of the whole program with --in-process)
         --disable-inlining         : Disable inlining
         --force-inline-bounce      : Force inlining of bounce functions generated by devirt
         --force-inline-spec        : Force inlining of functions generated by specialization
@@ -88,9 +91,14 @@ instructions = """slash has three modes of use:
         --enable-config-prime      : Enable dynamic analysis to propagate manifest data (experimental)
         --llpe                     : Use Smowton's LLPE for intra-module prunning (experimental)
         --ipdse                    : Apply inter-procedural dead store elimination (experimental)
+        --ipdse-shadow-mem         : With --ipdse, propagate constants through the memory SSA form of sea-dsa (experimental)
         --mc-dce                   : Use model-checking to perform intra-module dead code elimination (experimental)
         --ai-dce                   : Use invariants inferred by abstract interpretation for intra-module dce (experimental)
         --amalgamate=<file>        : Amalgamate the bitcode into a single <file> before linking (used to deal with duplicate symbols)
+        --jobs=N                   : Number of modules processed in parallel (default: number of cores)
+        --in-process               : Run the global fixpoint in a single occam-slash process instead of calling opt for each step
+        --cache-dir=<dir>          : Reuse the results of previous calls to opt stored in <dir> (and store new ones)
+        --cache-size=N             : Maximum size in MB of the cache directory (default: 1024)
     """
 
 def entrypoint():
@@ -103,11 +111,18 @@ def entrypoint():
     slash --help
 
     """
-    return Slash(sys.argv).run() if utils.checkOccamLib() else 1
+    if not utils.checkOccamLib():
+        return 1
+    try:
+        return Slash(sys.argv).run()
+    except pool.JobFailed as ex:
+        sys.stderr.write('\nslash: {0}. Aborting.\n'.format(ex))
+        pool.shutdownDefaultPool()
+        return 1
 
 
 def  usage(exe):
-    template = '{0} [--work-dir=<dir>]  [--force] [--help] [--stats] [--opt-stats] [--no-strip] [--verbose] [--debug-manager=] [--debug-pass=] [--debug] [--print-after-all] [--devirt=<type>] [--intra-spec-policy=<type>] [--inter-spec-policy=<type>] [--max-bounded-spec=N] [--disable-inlining] [--force-inline-bounce] [--force-inline-spec] [--keep-external=<file>] [--enable-config-prime] [--llpe] [--ipdse] [--mc-dce] [--ai-dce] <manifest>\n'
+    template = '{0} [--work-dir=<dir>]  [--force] [--help] [--stats] [--opt-stats] [--no-strip] [--verbose] [--debug-manager=] [--debug-pass=] [--debug] [--print-after-all] [--devirt=<type>] [--intra-spec-policy=<type>] [--inter-spec-policy=<type>] [--max-bounded-spec=N] [--spec-budget=N] [--disable-inlining] [--force-inline-bounce] [--force-inline-spec] [--keep-external=<file>] [--enable-config-prime] [--llpe] [--ipdse] [--ipdse-shadow-mem] [--mc-dce] [--ai-dce] [--jobs=N] [--in-process] [--cache-dir=<dir>] [--cache-size=N] <manifest>\n'
     sys.stderr.write(template.format(exe))
 
 class Slash(object):
@@ -128,6 +143,7 @@ class Slash(object):
                         'llpe',
                         'help',
                         'ipdse',
+                        'ipdse-shadow-mem',
                         'mc-dce',
                         'ai-dce',
                         'info',
@@ -136,13 +152,18 @@ class Slash(object):
                         'intra-spec-policy=',
                         'inter-spec-policy=',
                         'max-bounded-spec=',
+                        'spec-budget=',
                         'disable-inlining',
                         'force-inline-bounce',
                         'force-inline-spec',
                         'tool=',
                         'verbose',
                         'keep-external=',
-                        'amalgamate=']
+                        'amalgamate=',
+                        'jobs=',
+                        'in-process',
+                        'cache-dir=',
+                        'cache-size=']
             parsedargs = getopt.getopt(argv[1:], None, cmdflags)
             (self.flags, self.args) = parsedargs
 
@@ -177,7 +198,19 @@ class Slash(object):
                 return
 
         self.work_dir = utils.get_work_dir(self.flags)
-        self.pool = pool.getDefaultPool()
+
+        jobs = utils.get_flag(self.flags, 'jobs', None)
+        if jobs is not None:
+            try:
+                jobs = int(jobs)
+            except ValueError:
+                jobs = 0
+            if jobs < 1:
+                print('The number of jobs "{0}" must be a positive integer.'.format(
+                    utils.get_flag(self.flags, 'jobs')))
+                self.valid = False
+                return
+        self.pool = pool.getDefaultPool(jobs)
         self.valid = True
         self.amalgamation = utils.get_amalgamation(self.flags)
 
@@ -195,15 +228,16 @@ class Slash(object):
             return 1
 
         def check_spec_policy(policy):
-            """ Supported policies: none, aggressive, nonrec-aggressive, bounded or onlyonce """
+            """ Supported policies: none, aggressive, nonrec-aggressive, bounded, onlyonce or profitable """
 
             if policy <> 'none' and \
                policy <> 'aggressive' and \
                policy <> 'bounded' and \
                policy <> 'onlyonce' and \
+               policy <> 'profitable' and \
                policy <> 'nonrec-aggressive':
                 sys.stderr.write('Error: unsupported specialization policy. ' + \
-                                 'Valid policies: none, aggressive, nonrec-aggressive, bounded, onlyonce')
+                                 'Valid policies: none, aggressive, nonrec-aggressive, bounded, onlyonce, profitable')
                 return False
             else:
                 return True
@@ -229,7 +263,7 @@ class Slash(object):
         if not valid:
             return 1
 
-        (valid, module, binary, libs, native_libs, ldflags, args, name, constraints) = parsed
+        (valid, module, binary, libs, native_libs, ldflags, args, name, constraints, profile) = parsed
 
 
         if not self.driver_config():
@@ -242,6 +276,13 @@ class Slash(object):
             use_config_prime = True
         else:
             use_config_prime = False
+
+        if profile is not None and profile != 'interpreter':
+            # make it survive the chdir into the work directory
+            profile = os.path.realpath(profile)
+        elif profile == 'interpreter' and not use_config_prime:
+            sys.stderr.write('Warning: the interpreter profile requires --enable-config-prime; ignoring it\n')
+            profile = None
         
         use_llpe = utils.get_flag(self.flags, 'llpe', None)
         if use_llpe is not None:
@@ -255,6 +296,13 @@ class Slash(object):
         else:
             use_ipdse = False
 
+        self.ipdse_shadow_mem = False
+        if utils.get_flag(self.flags, 'ipdse-shadow-mem', None) is not None:
+            if use_ipdse:
+                self.ipdse_shadow_mem = True
+            else:
+                sys.stderr.write('Warning: --ipdse-shadow-mem requires --ipdse; ignoring it\n')
+
         use_mc_dce = utils.get_flag(self.flags, 'mc-dce', None)
         if use_mc_dce is not None:
             use_mc_dce = True
@@ -267,6 +315,12 @@ class Slash(object):
         else:
             use_ai_dce = False
 
+        in_process = utils.get_flag(self.flags, 'in-process', None)
+        if in_process is not None:
+            in_process = True
+        else:
+            in_process = False
+
         show_stats = utils.get_flag(self.flags, 'stats', None)
         info = utils.get_flag(self.flags, 'info', None)
         if info is not None:
@@ -282,6 +336,10 @@ class Slash(object):
 
         # Only used if intra_spec_policy or inter_spec_policy = bounded
         max_bounded_spec = utils.get_flag(self.flags, 'max-bounded-spec', None)
+
+        # Shared by the intra and inter-module specializations of a
+        # module across all the iterations of the fixpoint
+        self.spec_budget = utils.get_flag(self.flags, 'spec-budget', None)
         
         devirt = utils.get_flag(self.flags, 'devirt', 'none')
         if not check_devirt_method(devirt):
@@ -362,6 +420,17 @@ class Slash(object):
             print_profile_maps()
             return
 
+        ### Attach the execution profile before anything changes the CFGs
+        ### that it was recorded against.
+        if profile is not None and profile != 'interpreter':
+            sys.stderr.write('Annotating modules with the profile {0}\n'.format(profile))
+            def _profile_use(m):
+                "Profile use"
+                pre = m.get()
+                post = m.new('pgo')
+                passes.profile_use(pre, post, profile)
+            pool.InParallel(_profile_use, files.values(), self.pool)
+
         ### 0. Lift deployment information into main's module
         if args is not None:
             sys.stderr.write('Input-user specialization using fix parameters: {0}\n'.format(args))            
@@ -382,152 +451,43 @@ class Slash(object):
                 pre = main.get()
                 post = main.new('cp')
                 # args are already lowered in the bitcode
-                passes.config_prime(pre, post, list(), 0)
+                passes.config_prime(pre, post, list(), 0,
+                                    profile=(profile == 'interpreter'))
             elif constraints:
                 (num_unknown_args, known_args) = constraints
                 pre = main.get()
                 post = main.new('cp')
                 # known_args are already lowered in the bitcode
-                passes.config_prime(pre, post, list(), num_unknown_args)
+                passes.config_prime(pre, post, list(), num_unknown_args,
+                                    profile=(profile == 'interpreter'))
             
         # Create interface for main. We can never internalize main
         interface.writeInterface(interface.mainInterface(), 'main.iface')
 
-        ### 1. First compute the simple interfaces
-        vals = files.items()
-        def mkvf(k):
-            return provenance.VersionedFile(utils.prevent_collisions(k[:k.rfind('.bc')]),
-                                            'iface')
-        refs = dict([(k, mkvf(k)) for (k, _) in vals])
-
-        def _references((m, f)):
-            "Computing references"
-            nm = refs[m].new()
-            passes.interface(f.get(), nm, [])
-
-        pool.InParallel(_references, vals, self.pool)
-        ### 2. And internalize everything that we can
-        def _internalize((m, i)):
-            "Internalizing from interfaces"
-            pre = i.get()
-            post = i.new('i')
-            ifaces = [refs[f].get() for f in refs.keys() if f != m] + ['main.iface']
-            passes.internalize(pre, post, ifaces, self.whitelist)
-
-        pool.InParallel(_internalize, vals, self.pool)
-
-        # Begin main loop
-        iface_before_file = provenance.VersionedFile('interface_before', 'iface')
-        iface_after_file = provenance.VersionedFile('interface_after', 'iface')
-        progress = True
-        rewrite_files = {}
-        for m, _ in files.iteritems():
-            base = utils.prevent_collisions(m[:m.rfind('.bc')])
-            rewrite_files[m] = provenance.VersionedFile(base, 'rw')
-
         # Options passed to the optimizer (opt)
         opt_options = []
         if no_inlining is not None:
             opt_options += ['-disable-inlining']
 
-        utils.write_timestamp("Started global fixpoint ...")
-        iteration = 0
         max_fixpoint_iterations = 10 ## make this user parameter
-        while progress:
-            iteration += 1
-            if iteration > max_fixpoint_iterations:
-                sys.stderr.write('Fixpoint took more than ' + \
-                                 str(max_fixpoint_iterations) + ". " + \
-                                 'Stopping fixpoint.')
-                break
-            progress = False
 
-            ### 3. Intra-module partial evaluation
-            def intra(m):
-                "Intra-module specialization/optimization"
-                pre = m.get()
-                pre_base = os.path.basename(pre)
-                post = m.new('p')
-                post_base = os.path.basename(post)
-                fn = 'previrt_%s-%s' % (pre_base, post_base)
-                print "\tModule: " + str(pre)
-                print "\tIntra-specialization policy={0}".format(intra_spec_policy)
-                if intra_spec_policy == 'bounded':
-                    print "\tMax number of copies={0}".format(max_bounded_spec)
-                passes.peval(pre, post, \
-                             opt_options, \
-                             intra_spec_policy, \
-                             max_bounded_spec, \
-                             devirt, \
-                             inline_bounce, inline_spec, \
-                             use_llpe, use_ipdse, use_ai_dce, \
-                             log=open(fn, 'w'))
-
-            pool.InParallel(intra, files.values(), self.pool)
-
-            ### 4. Gather Inter-module interfaces
-            iface = passes.deep([x.get() for x in files.values()],
-                                ['main.iface'])
-            interface.writeInterface(iface, iface_before_file.new())
-
-            ### 5. Inter-specialize
-            if inter_spec_policy <> 'none':
+        if in_process and (use_llpe or use_ai_dce):
+            sys.stderr.write('--llpe and --ai-dce are not supported by occam-slash: ' + \
+                             'running the global fixpoint with opt\n')
+            in_process = False
 
-                # Create specialized functions and rewrite specification
-                def inter_spec((nm, m)):
-                    "Inter-module module specialization"
-                    pre = m.get()
-                    post = m.new('s')
-                    rw = rewrite_files[nm].new()
-                    passes.specialize(pre, post, rw, [iface_before_file.get()],
-                                      inter_spec_policy, max_bounded_spec)
-
-                print "\tInter-specialization policy={0}".format(inter_spec_policy)
-                if inter_spec == 'bounded':
-                    print "\tMax number of copies={0}".format(max_bounded_spec)
-                    
-                pool.InParallel(inter_spec, files.items(), self.pool)
-
-                # Rewrite
-                def inter_rewrite((nm, m)):
-                    "Inter-module module rewriting"
-                    pre = m.get()
-                    post = m.new('r')
-                    rws = [rewrite_files[x].get() for x in files.keys()
-                           if x != nm]
-                    out = [None]
-                    retcode = passes.rewrite(pre, post, rws, output=out)
-                    fn = 'rewrite_%s-%s' % (os.path.basename(pre),
-                                            os.path.basename(post))
-                    dbg = open(fn, 'w')
-                    dbg.write(out[0])
-                    dbg.close()
-                    return retcode
-
-                rws = pool.InParallel(inter_rewrite, files.items(), self.pool)
-                
-                progress = any(rws)
-            else:
-                print "Skipped inter-module specialization"
-
-            # Aggressive internalization
-            pool.InParallel(_references, vals, self.pool)
-            pool.InParallel(_internalize, vals, self.pool)
-
-            ### 6. Sealing
-            
-            # Compute the interfaces again after new specialized functions
-            iface = passes.deep([x.get() for x in files.values()], ['main.iface'])
-            interface.writeInterface(iface, iface_after_file.new())
-
-            # internalize 
-            def sealing(m):
-                "Hides exported functions that are not referenced from outside the module"
-                pre = m.get()
-                post = m.new('h')
-                passes.internalize(pre, post, [iface_after_file.get()], self.whitelist)
-                
-            pool.InParallel(sealing, files.values(), self.pool)
+        utils.write_timestamp("Started global fixpoint ...")
+        if in_process:
+            if not self.fixpoint_in_process(files, opt_options, max_fixpoint_iterations,
+                                            intra_spec_policy, inter_spec_policy,
+                                            max_bounded_spec, devirt,
+                                            inline_bounce, inline_spec, use_ipdse):
+                return 1
+        else:
+            self.fixpoint(files, opt_options, max_fixpoint_iterations,
+                          intra_spec_policy, inter_spec_policy, max_bounded_spec,
+                          devirt, inline_bounce, inline_spec,
+                          use_llpe, use_ipdse, use_ai_dce)
 
         utils.write_timestamp("Finished global fixpoint.")
 
@@ -645,6 +605,236 @@ class Slash(object):
         return 0
 
 
+    def fixpoint(self, files, opt_options, max_fixpoint_iterations,
+                 intra_spec_policy, inter_spec_policy, max_bounded_spec,
+                 devirt, inline_bounce, inline_spec,
+                 use_llpe, use_ipdse, use_ai_dce):
+        """Global fixpoint: each step is a separate call to opt.
+
+           Every stage is memoized on the digests of the files it
+           consumes: a stage whose inputs did not change since it last
+           ran is not run again, and the fixpoint stops as soon as an
+           iteration leaves every module unchanged.
+        """
+        memo = provenance.StageMemo()
+        digests = memo.digests
+
+        ### 1. First compute the simple interfaces
+        vals = files.items()
+        def mkvf(k):
+            return provenance.VersionedFile(utils.prevent_collisions(k[:k.rfind('.bc')]),
+                                            'iface')
+        refs = dict([(k, mkvf(k)) for (k, _) in vals])
+
+        def _references((m, f)):
+            "Computing references"
+            inputs = [f.get()]
+            hit = memo.lookup('references', m, inputs)
+            if hit is not None:
+                memo.restore(refs[m], hit[0][0])
+                return
+            nm = refs[m].new()
+            passes.interface(f.get(), nm, [], mapped=True)
+            memo.record('references', m, inputs, [nm])
+
+        pool.InParallel(_references, vals, self.pool)
+        ### 2. And internalize everything that we can
+        def _internalize((m, i)):
+            "Internalizing from interfaces"
+            pre = i.get()
+            ifaces = [refs[f].get() for f in refs.keys() if f != m] + ['main.iface']
+            inputs = [pre] + ifaces
+            if self.whitelist is not None:
+                inputs.append(self.whitelist)
+            hit = memo.lookup('internalize', m, inputs)
+            if hit is not None:
+                memo.restore(i, hit[0][0], 'i')
+                return
+            post = i.new('i')
+            passes.internalize(pre, post, ifaces, self.whitelist)
+            memo.record('internalize', m, inputs, [post])
+
+        pool.InParallel(_internalize, vals, self.pool)
+
+        ### Interfaces of the whole program
+        def _deep(key, out):
+            modules = [x.get() for x in files.values()]
+            inputs = modules + ['main.iface']
+            hit = memo.lookup('deep', key, inputs)
+            if hit is not None:
+                memo.restore(out, hit[0][0])
+                return
+            iface = passes.deep(modules, ['main.iface'])
+            nm = out.new()
+            interface.writeInterface(iface, nm)
+            memo.record('deep', key, inputs, [nm])
+
+        # Begin main loop
+        iface_before_file = provenance.VersionedFile('interface_before', 'iface')
+        iface_after_file = provenance.VersionedFile('interface_after', 'iface')
+        progress = True
+        rewrite_files = {}
+        for m, _ in files.iteritems():
+            base = utils.prevent_collisions(m[:m.rfind('.bc')])
+            rewrite_files[m] = provenance.VersionedFile(base, 'rw')
+
+        iteration = 0
+        while progress:
+            iteration += 1
+            if iteration > max_fixpoint_iterations:
+                sys.stderr.write('Fixpoint took more than ' + \
+                                 str(max_fixpoint_iterations) + ". " + \
+                                 'Stopping fixpoint.')
+                break
+            progress = False
+            snapshot = digests([x.get() for x in files.values()])
+
+            ### 3. Intra-module partial evaluation
+            def intra(m):
+                "Intra-module specialization/optimization"
+                pre = m.get()
+                hit = memo.lookup('intra', m.base(), [pre])
+                if hit is not None:
+                    print "\tModule: " + str(pre) + " (unchanged)"
+                    memo.restore(m, hit[0][0], 'p')
+                    return
+                pre_base = os.path.basename(pre)
+                post = m.new('p')
+                post_base = os.path.basename(post)
+                fn = 'previrt_%s-%s' % (pre_base, post_base)
+                print "\tModule: " + str(pre)
+                print "\tIntra-specialization policy={0}".format(intra_spec_policy)
+                if intra_spec_policy == 'bounded':
+                    print "\tMax number of copies={0}".format(max_bounded_spec)
+                passes.peval(pre, post, \
+                             opt_options, \
+                             intra_spec_policy, \
+                             max_bounded_spec, \
+                             devirt, \
+                             inline_bounce, inline_spec, \
+                             use_llpe, use_ipdse, use_ai_dce, \
+                             log=open(fn, 'w'), budget=self.spec_budget,
+                             ipdse_shadow_mem=self.ipdse_shadow_mem)
+                memo.record('intra', m.base(), [pre], [post])
+
+            pool.InParallel(intra, files.values(), self.pool)
+
+            ### 4. Gather Inter-module interfaces
+            _deep('before', iface_before_file)
+
+            ### 5. Inter-specialize
+            if inter_spec_policy <> 'none':
+
+                # Create specialized functions and rewrite specification
+                def inter_spec((nm, m)):
+                    "Inter-module module specialization"
+                    pre = m.get()
+                    inputs = [pre, iface_before_file.get()]
+                    hit = memo.lookup('specialize', nm, inputs)
+                    if hit is not None:
+                        memo.restore(m, hit[0][0], 's')
+                        memo.restore(rewrite_files[nm], hit[0][1])
+                        return
+                    post = m.new('s')
+                    rw = rewrite_files[nm].new()
+                    passes.specialize(pre, post, rw, [iface_before_file.get()],
+                                      inter_spec_policy, max_bounded_spec,
+                                      mapped=True, budget=self.spec_budget)
+                    memo.record('specialize', nm, inputs, [post, rw])
+
+                print "\tInter-specialization policy={0}".format(inter_spec_policy)
+                if inter_spec == 'bounded':
+                    print "\tMax number of copies={0}".format(max_bounded_spec)
+                    
+                pool.InParallel(inter_spec, files.items(), self.pool)
+
+                # Rewrite
+                def inter_rewrite((nm, m)):
+                    "Inter-module module rewriting"
+                    pre = m.get()
+                    rws = [rewrite_files[x].get() for x in files.keys()
+                           if x != nm]
+                    inputs = [pre] + rws
+                    hit = memo.lookup('rewrite', nm, inputs)
+                    if hit is not None:
+                        memo.restore(m, hit[0][0], 'r')
+                        return hit[1]
+                    post = m.new('r')
+                    out = [None]
+                    retcode = passes.rewrite(pre, post, rws, output=out)
+                    fn = 'rewrite_%s-%s' % (os.path.basename(pre),
+                                            os.path.basename(post))
+                    dbg = open(fn, 'w')
+                    dbg.write(out[0])
+                    dbg.close()
+                    memo.record('rewrite', nm, inputs, [post], retcode)
+                    return retcode
+
+                rws = pool.InParallel(inter_rewrite, files.items(), self.pool)
+                
+                progress = any(rws)
+            else:
+                print "Skipped inter-module specialization"
+
+            # Aggressive internalization
+            pool.InParallel(_references, vals, self.pool)
+            pool.InParallel(_internalize, vals, self.pool)
+
+            ### 6. Sealing
+            
+            # Compute the interfaces again after new specialized functions
+            _deep('after', iface_after_file)
+
+            # internalize 
+            def sealing(m):
+                "Hides exported functions that are not referenced from outside the module"
+                pre = m.get()
+                inputs = [pre, iface_after_file.get()]
+                if self.whitelist is not None:
+                    inputs.append(self.whitelist)
+                hit = memo.lookup('sealing', m.base(), inputs)
+                if hit is not None:
+                    memo.restore(m, hit[0][0], 'h')
+                    return
+                post = m.new('h')
+                passes.internalize(pre, post, [iface_after_file.get()], self.whitelist)
+                memo.record('sealing', m.base(), inputs, [post])
+                
+            pool.InParallel(sealing, files.values(), self.pool)
+
+            if progress and digests([x.get() for x in files.values()]) == snapshot:
+                print "No module changed in iteration {0}. Stopping fixpoint.".format(iteration)
+                progress = False
+
+        print "Fixpoint stages: {0} run, {1} skipped".format(memo.misses, memo.hits)
+
+    def fixpoint_in_process(self, files, opt_options, max_fixpoint_iterations,
+                            intra_spec_policy, inter_spec_policy, max_bounded_spec,
+                            devirt, inline_bounce, inline_spec, use_ipdse):
+        """Global fixpoint: all the steps are run by occam-slash
+           without writing intermediate bitcode.
+        """
+        occam_slash = config.get_occam_slash()
+        if occam_slash is None or not os.path.exists(occam_slash):
+            sys.stderr.write('occam-slash was not found. RTFM.\n')
+            return False
+
+        inputs = [x.get() for x in files.values()]
+        outputs = [x.new('z') for x in files.values()]
+        try:
+            passes.slash(inputs, outputs, ['main.iface'], self.whitelist,
+                         opt_options,
+                         intra_spec_policy, inter_spec_policy, max_bounded_spec,
+                         devirt, inline_bounce, inline_spec,
+                         use_ipdse, max_fixpoint_iterations,
+                         budget=self.spec_budget,
+                         ipdse_shadow_mem=self.ipdse_shadow_mem)
+        except driver.ReturnCode as ex:
+            sys.stderr.write('occam-slash failed: {0}\n'.format(ex))
+            return False
+        return True
+
+
     def driver_config(self):
 
         work_dir = utils.get_work_dir(self.flags)
@@ -679,4 +869,27 @@ class Slash(object):
         if verbose is not None:
             driver.verbose = True
 
+        cache_dir = utils.get_flag(self.flags, 'cache-dir', None)
+        if cache_dir is not None:
+            cache_dir = os.path.abspath(cache_dir)
+            if not os.path.isdir(cache_dir):
+                try:
+                    os.makedirs(cache_dir)
+                except OSError:
+                    print('Cannot create the cache directory "{0}".'.format(cache_dir))
+                    return False
+            cache.cache_dir = cache_dir
+
+        cache_size = utils.get_flag(self.flags, 'cache-size', None)
+        if cache_size is not None:
+            try:
+                cache_size = int(cache_size)
+            except ValueError:
+                cache_size = 0
+            if cache_size < 1:
+                print('The cache size "{0}" must be a positive integer.'.format(
+                    utils.get_flag(self.flags, 'cache-size')))
+                return False
+            cache.max_size = cache_size * 1024 * 1024
+
         return True
@@ -105,7 +105,7 @@ def make_work_dir(d):
 def sanity_check_manifest(manifest):
     """ Nurse maid the users.
     """
-    manifest_keys = ['ldflags', 'args', 'name', 'native_libs', 'binary', 'modules']
+    manifest_keys = ['ldflags', 'args', 'name', 'native_libs', 'binary', 'modules', 'profile']
 
     old_manifest_keys = ['modules', 'libs', 'search', 'shared']
 
@@ -198,7 +198,13 @@ def check_manifest(manifest):
         sys.stderr.write('No name in manifest\n')
         return (False, )
 
-    return (True, main, binary, modules, native_libs, ldflags, args, name, constraints)
+    profile = manifest.get('profile')
+    if profile is not None and profile != 'interpreter' and \
+       not (profile.endswith('.profdata') and os.path.isfile(profile)):
+        sys.stderr.write('The profile must be an existing .profdata file or "interpreter"\n')
+        return (False, )
+
+    return (True, main, binary, modules, native_libs, ldflags, args, name, constraints, profile)
 
 
 #iam: used to be just os.path.basename; but now when we are processing trees
@@ -42,38 +42,20 @@ using namespace llvm;
 
 namespace previrt {
 
-  static StringRef OccamSpecStr = "__occam_spec.";
-  
-  BoundedSpecPolicy::BoundedSpecPolicy(Module &M, 
+  BoundedSpecPolicy::BoundedSpecPolicy(Module &M,
+				       const SpecializationTable &table,
 				       std::unique_ptr<SpecializationPolicy> subpolicy,
 				       unsigned threshold)
-    : m_subpolicy(std::move(subpolicy))
+    : m_table(table)
+    , m_subpolicy(std::move(subpolicy))
     , m_threshold(threshold) {
 
-    // HACK: slash can run the specializer on the same module multiple
-    // times.  We need to try to identify if a function has been
-    // specialized already (and how many times) in order to start with
-    // the right counter. Otherwise, the bounded policy will become
-    // aggressive.
-
+    // slash can run the specializer on the same module multiple
+    // times. Start with the number of copies that the earlier runs
+    // made. Otherwise, the bounded policy will become aggressive.
     for (auto &F: M) {
-      if (F.isDeclaration()) continue;
-      if (F.getName().startswith(OccamSpecStr)) {
-    	StringRef name = F.getName();
-    	// remove "__occam.spec."
-    	name = name.split(OccamSpecStr).second;
-    	// keep the string just before the first ( character
-    	name = name.split("(").first;
-    	// We might fail updating the counter if two functions have
-    	// the same name.
-    	if (const Function *specFunction = M.getFunction(name)) {
-    	  auto it = m_num_copy_map.find(specFunction);
-    	  if (it != m_num_copy_map.end()) {
-    	    it->second++;
-    	  } else {
-    	    m_num_copy_map.insert(std::make_pair(specFunction, 1));
-    	  }
-    	}
+      if (m_table.isSpecialization(&F)) {
+	m_num_copy_map[m_table.getPrincipalFunction(&F)]++;
       }
     }
   }
@@ -95,7 +77,7 @@ namespace previrt {
     if (!calleeF) {
       return false;
     }
-    if (calleeF->getName().startswith(OccamSpecStr)) {
+    if (m_table.isSpecialization(calleeF)) {
       return false;
     }
 
@@ -120,7 +102,7 @@ namespace previrt {
 					    const ComponentInterface& interface,
 					    SmallBitVector& marks)  {
 
-    if (calleeF.getName().startswith(OccamSpecStr)) {
+    if (m_table.isSpecialization(&calleeF)) {
       return false;
     }
     
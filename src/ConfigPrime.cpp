@@ -1,4 +1,5 @@
 #include "llvm/Pass.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
@@ -6,12 +7,17 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/ProfileData/InstrProf.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Scalar.h"
 
 #include "interpreter/Interpreter.h"
 #include "ConfigPrime.h"
 
+#include <algorithm>
+
 using namespace llvm;
 
 static cl::opt<std::string>
@@ -30,6 +36,12 @@ UnknownArgs("Pconfig-prime-unknown-args",
 	  cl::init(0),
 	  cl::desc("Specify the number of unknown parameters"));
 
+static cl::opt<bool>
+AttachProfile("Pconfig-prime-profile",
+	      cl::Hidden,
+	      cl::init(false),
+	      cl::desc("Attach the execution counts of the run as profile metadata"));
+
 namespace previrt {
 
 /** Begin helpers **/
@@ -96,6 +108,67 @@ static std::vector<GenericValue> prepareArgumentsForMain(Function *mainFn,
   return GVArgs;
 }
 
+/* 
+ * Attach the execution counts of the run to M in the same form as
+ * opt -pgo-instr-use: function entry counts, branch weights and value
+ * profiles of the indirect calls.
+ *
+ * A count of zero only means "cold" if the run reached the end of
+ * main. If the interpreter stopped earlier the functions it did not
+ * reach are left without an entry count.
+ */
+static void annotateProfile(Module &M, const Interpreter &Interp) {
+  const unsigned MaxTargets = 64;
+  const bool Finished = !Interp.getLastExecutedInst();
+  MDBuilder MDB(M.getContext());
+  for (auto &F: M) {
+    if (F.isDeclaration()) continue;
+    uint64_t EntryCount = Interp.getExecutionCount(F);
+    if (EntryCount == 0 && !Finished) continue;
+    F.setEntryCount(EntryCount);
+    for (auto &BB: F) {
+      TerminatorInst *T = BB.getTerminator();
+      if (T && T->getNumSuccessors() > 1 &&
+	  (isa<BranchInst>(T) || isa<SwitchInst>(T))) {
+	SmallVector<uint64_t, 4> counts;
+	uint64_t max = 0;
+	SmallPtrSet<const BasicBlock*, 4> seen;
+	for (unsigned i = 0, e = T->getNumSuccessors(); i < e; ++i) {
+	  const BasicBlock *Succ = T->getSuccessor(i);
+	  // the count of an edge goes to its first occurrence
+	  uint64_t c = seen.insert(Succ).second ? Interp.getExecutionCount(BB, *Succ) : 0;
+	  counts.push_back(c);
+	  max = std::max(max, c);
+	}
+	if (max > 0) {
+	  // weights are 32 bits
+	  uint64_t scale = (max >> 32) + 1;
+	  SmallVector<uint32_t, 4> weights;
+	  for (uint64_t c: counts) {
+	    weights.push_back(c / scale);
+	  }
+	  T->setMetadata(LLVMContext::MD_prof, MDB.createBranchWeights(weights));
+	}
+      }
+      for (auto &I: BB) {
+	if (auto *Callees = Interp.getCallees(I)) {
+	  std::vector<InstrProfValueData> VDs;
+	  uint64_t Sum = 0;
+	  for (auto &kv: *Callees) {
+	    VDs.push_back({IndexedInstrProf::ComputeHash(getPGOFuncName(*kv.first)), kv.second});
+	    Sum += kv.second;
+	  }
+	  std::sort(VDs.begin(), VDs.end(),
+		    [](const InstrProfValueData &a, const InstrProfValueData &b) {
+		      return a.Count > b.Count;
+		    });
+	  annotateValueSite(M, I, VDs, Sum, IPVK_IndirectCallTarget, MaxTargets);
+	}
+      }
+    }
+  }
+}
+
 static void extractValuesFromRun(Interpreter &Interp, Pass *CPPass,
 				 DenseMap<Value*, RawAndDerefValue> &GlobalValues,
 				 DenseMap<Value*, RawAndDerefValue> &StackValues,
@@ -329,6 +402,10 @@ bool ConfigPrime::runOnModule(Module& M) {
   SmallVector<BasicBlock*, 4> Continuations;
   extractValuesFromRun(*Interp, this,
 		       GlobalValues, StackValues, Continuations);
+
+  if (AttachProfile) {
+    annotateProfile(M, *Interp);
+  }
 				       
   #if 0
   auto printValueMap = [](DenseMap<Value*,RawAndDerefValue> &m, raw_ostream &o) {
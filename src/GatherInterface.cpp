@@ -32,17 +32,23 @@
 //
 
 #include "llvm/ADT/iterator_range.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Pass.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Analysis/CallGraph.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
 
-#include "PrevirtualizeInterfaces.h"
+#include "Previrtualize.h"
+#include "MappedInterface.h"
 
+#include <memory>
 #include <vector>
 #include <set>
 #include <string>
@@ -63,6 +69,23 @@ GatherInterfaceEntry("Pinterface-entry",
 		     cl::Hidden,
 		     cl::desc("specifies the interface that is used (only function names)"));
 
+static cl::opt<bool>
+GatherDeepInterfaceOpt("Pdeep-interface",
+		       cl::init(false),
+		       cl::Hidden,
+		       cl::desc("compute the interface across the module and all -Pdeep-interface-module"));
+
+static cl::list<std::string>
+GatherDeepInterfaceModules("Pdeep-interface-module",
+			   cl::Hidden,
+			   cl::desc("specifies other modules of the program (used with -Pdeep-interface)"));
+
+static cl::opt<unsigned>
+GatherInterfaceMaxCalls("Pinterface-max-calls",
+			cl::init(64),
+			cl::Hidden,
+			cl::desc("maximum number of calls recorded per function (0 for no limit)"));
+
 namespace previrt {
 
 static bool isInternal(const Function* f) {
@@ -96,6 +119,239 @@ static Value *stripBitCast(Value *V) {
   }
 }
 
+/*
+ * Add to the interface the symbols of M that must be kept external
+ * independently of the entry points: llvm.used and declarations.
+ */
+static void gatherReferences(Module& M, ComponentInterface& interface) {
+  // Add all nodes in llvm.compiler.used and llvm.used
+  // *** This is very important for correctly compiling libc
+  static const char* used_vars[2] = {"llvm.compiler.used", "llvm.used"};
+  for (int i = 0; i < 2; ++i) {
+    GlobalVariable* used = M.getGlobalVariable(used_vars[i], true);
+    if (used) {
+      Constant* value = used->getInitializer();
+      assert(value);
+      
+      if (value->getType()->isVectorTy()) {
+	for (unsigned int i=0; i < value->getNumOperands(); ++i) {
+	  GlobalValue* gv = getGlobal(value->getAggregateElement(i));
+	  if (!gv || gv->hasInternalLinkage()) continue;
+	  interface.reference(gv->getName());
+	  errs() << "adding reference to '" << gv->getName() << "'\n";
+	}
+	errs() << "vector!";
+      } else if (ConstantArray* ary = dyn_cast<ConstantArray>(value)) {
+	for (ConstantArray::op_iterator begin = ary->op_begin(), end = ary->op_end();
+	     begin != end; ++begin) {
+	  if (GlobalValue* gv = getGlobal(begin->get())) {
+	    interface.reference(gv->getName());
+	  }
+	}
+      } else {
+	errs() << used_vars[i] << " = \n" << *value << "\n";
+      }
+    }
+  }
+  
+  // functions
+  for (Function &F: llvm::make_range(M.begin(), M.end())) {
+    if (F.isDeclaration() && !F.isIntrinsic()) {
+      errs() << "Added reference to function " << F.getName() << "\n";
+      interface.reference(F.getName());
+    }
+  }
+  
+  // global variables
+  for (GlobalVariable &gv: M.globals()) {
+    if (gv.isDeclaration()) {
+      errs() << "Added reference to global " << gv.getName() << "\n";	
+      interface.reference(gv.getName());
+    }
+  }
+  
+  // aliases 
+  for (GlobalAlias &alias: M.aliases()) {
+    if (alias.isDeclaration()) {
+      errs() << "Added reference to alias " << alias.getName() << "\n";		
+      interface.reference(alias.getName());
+    }
+  }
+}
+
+/*
+ * Traverse the call graph from the nodes in queue and add to the
+ * interface the calls to external functions. If callees is not null
+ * then the names of the recorded functions are added to it.
+ */
+static void traverseCallGraph(CallGraph& cg,
+			      std::vector<CallGraphNode*>& queue,
+			      std::set<CallGraphNode*>& visited,
+			      ComponentInterface& interface,
+			      std::vector<StringRef>* callees) {
+  while (!queue.empty()) {
+    CallGraphNode* cgn = queue.back();
+    queue.pop_back();
+    
+    if (cgn->getFunction() && !isInternal(cgn->getFunction())) {
+      // this is a declaration and doesn't have any calls
+      continue;
+    }
+    
+    if (cgn == cg.getCallsExternalNode()) {
+      // In this case, we're here from a call that we can't resolve,
+      // so we need to be conservative.
+      // Everything that could have made it into this set is in the
+      // "External Calling" node, i.e. can be called externally
+      // - stored in a variable or externally visible
+      // NOTE: for this to be useful, we're going to need to minimize
+      // the size of the "externally visible" set.
+      cgn = cg.getExternalCallingNode();
+      if (visited.find(cgn) != visited.end()) {
+	continue;
+      }
+    }
+    
+    for (auto &callRecord : *cgn) {
+      Value *calledV = stripBitCast(callRecord.first);
+      if (!calledV) {
+	/////
+	// JN: I think we are here if cgn is cg.getExternalCallingNode()
+	//////
+	assert(cgn == cg.getExternalCallingNode());
+	assert(callRecord.second->getFunction());	  
+	interface.callAny(callRecord.second->getFunction());
+	if (callees) callees->push_back(callRecord.second->getFunction()->getName());
+      } else {
+	CallSite CS(calledV);
+	const Function *callee = callRecord.second->getFunction();
+	if (callee && !isInternal(callee)) {
+	  errs() << "External call to "
+		 << callRecord.second->getFunction()->getName() << "\n";
+	  // record in the interface a known external call
+	  interface.call(callee->getName(), CS.arg_begin(), CS.arg_end());
+	  if (callees) callees->push_back(callee->getName());
+	  continue;
+	}
+      }
+      
+      if (visited.insert(cgn).second) {
+	queue.push_back(callRecord.second);
+      }
+    }
+  }
+}
+
+/*
+ * Compute the external dependencies of M.  If entries is not null
+ * then the call graph is traversed starting from the functions
+ * called in entries. Otherwise, the traversal starts from all
+ * non-internal and address-taken functions.
+ */
+void GatherInterface(Module& M, CallGraph& cg,
+		     const ComponentInterface* entries,
+		     ComponentInterface& interface) {
+  errs() << "GatherInterfacePass::runOnModule: " << M.getModuleIdentifier() << "\n";
+
+  gatherReferences(M, interface);
+  
+  // Traverse the call graph
+  std::vector<CallGraphNode*> queue;
+  
+  if (entries) {
+    const ComponentInterface& ci = *entries;
+    //errs() << "Searching for external symbols starting from "
+    //       << "entries given by the interfaces of other modules:\n";
+    for (ComponentInterface::FunctionIterator i = ci.begin(), e = ci.end(); i != e; ++i) {
+      if (Function* f = M.getFunction(i->first())) {
+	// errs() << "\tAdded " << f->getName() << "into the queue.\n";	  
+	queue.push_back(cg.getOrInsertFunction(f));
+      }
+    }
+  } else {
+    //errs() << "Searching for external symbols starting from non-internal and "
+    //       << "address-taken functions:\n";
+    queue.push_back(cg.getExternalCallingNode());
+  }
+  
+  std::set<CallGraphNode*> visited;
+  traverseCallGraph(cg, queue, visited, interface, nullptr);
+}
+
+/*
+ * Compute the interface of the whole program formed by modules
+ * starting from the calls in entries.
+ *
+ * This is the closure computed by razor's deep but each module is
+ * traversed only from the functions that have not been reached yet.
+ * A function is an entry point of a module if it is defined there
+ * and it is called from some other module (or from entries).
+ */
+void GatherDeepInterface(const std::vector<Module*>& modules,
+			 const ComponentInterface& entries,
+			 ComponentInterface& out) {
+  struct ModuleState {
+    Module* module;
+    std::unique_ptr<CallGraph> cg;
+    std::set<CallGraphNode*> visited;
+  };
+  
+  out.join(entries);
+  
+  std::vector<ModuleState> states(modules.size());
+  // map each function name to the modules where it is defined
+  StringMap<std::vector<unsigned>> definitions;
+  for (unsigned i = 0, e = modules.size(); i < e; ++i) {
+    Module& M = *modules[i];
+    errs() << "GatherDeepInterface: " << M.getModuleIdentifier() << "\n";
+    states[i].module = &M;
+    states[i].cg.reset(new CallGraph(M));
+    gatherReferences(M, out);
+    for (Function &F: M) {
+      if (!F.isDeclaration()) {
+	definitions[F.getName()].push_back(i);
+      }
+    }
+  }
+
+  std::vector<std::string> worklist;
+  StringSet<> seen;
+  for (ComponentInterface::FunctionIterator i = out.begin(), e = out.end(); i != e; ++i) {
+    if (seen.insert(i->first()).second) {
+      worklist.push_back(i->first().str());
+    }
+  }
+
+  while (!worklist.empty()) {
+    std::string name = worklist.back();
+    worklist.pop_back();
+    
+    StringMap<std::vector<unsigned>>::iterator it = definitions.find(name);
+    if (it == definitions.end()) {
+      continue;
+    }
+
+    for (unsigned i: it->second) {
+      ModuleState& state = states[i];
+      Function* f = state.module->getFunction(name);
+      assert(f);
+      std::vector<CallGraphNode*> queue;
+      queue.push_back(state.cg->getOrInsertFunction(f));
+      std::vector<StringRef> callees;
+      traverseCallGraph(*state.cg, queue, state.visited, out, &callees);
+      for (StringRef callee: callees) {
+	if (seen.insert(callee).second) {
+	  worklist.push_back(callee.str());
+	}
+      }
+    }
+  }
+}
+
+unsigned getInterfaceMaxCalls() {
+  return GatherInterfaceMaxCalls;
+}
+
 class GatherInterfacePass : public ModulePass {
 public:
   ComponentInterface interface;
@@ -113,158 +369,60 @@ public:
   
   virtual bool runOnModule(Module& M) {
     // TODO: use SeaDsaCompleteCallGraph
-    CallGraphWrapperPass& cg = getAnalysis<CallGraphWrapperPass>();
-    
-    errs() << "GatherInterfacePass::runOnModule: " << M.getModuleIdentifier() << "\n";
+    CallGraph& cg = getAnalysis<CallGraphWrapperPass>().getCallGraph();
 
-    //errs() << "#=========== CallGraph=========#\n";
-    //cg.dump();
-    
-    // Add all nodes in llvm.compiler.used and llvm.used
-    // *** This is very important for correctly compiling libc
-    static const char* used_vars[2] = {"llvm.compiler.used", "llvm.used"};
-    for (int i = 0; i < 2; ++i) {
-      GlobalVariable* used = M.getGlobalVariable(used_vars[i], true);
-      if (used) {
-	Constant* value = used->getInitializer();
-	assert(value);
-	
-	if (value->getType()->isVectorTy()) {
-	  for (unsigned int i=0; i < value->getNumOperands(); ++i) {
-	    GlobalValue* gv = getGlobal(value->getAggregateElement(i));
-	    if (!gv || gv->hasInternalLinkage()) continue;
-	    interface.reference(gv->getName());
-	    errs() << "adding reference to '" << gv->getName() << "'\n";
-            }
-	  errs() << "vector!";
-	} else if (ConstantArray* ary = dyn_cast<ConstantArray>(value)) {
-	  for (ConstantArray::op_iterator begin = ary->op_begin(), end = ary->op_end();
-	       begin != end; ++begin) {
-	    if (GlobalValue* gv = getGlobal(begin->get())) {
-	      interface.reference(gv->getName());
-	    }
-	  }
-	} else {
-	  errs() << used_vars[i] << " = \n" << *value << "\n";
-	}
-      }
-    }
-    
-    // Traverse the call graph
-    std::vector<CallGraphNode*> queue;
-    
+    std::unique_ptr<ComponentInterface> entries;
     if (!GatherInterfaceEntry.empty()) {
-      ComponentInterface ci;
+      entries.reset(new ComponentInterface());
       for (cl::list<std::string>::const_iterator i = GatherInterfaceEntry.begin(),
 	     e = GatherInterfaceEntry.end();
 	   i != e; ++i) {
 	errs() << "Reading interface from '" << *i << "'...";
-	if (ci.readFromFile(*i)) {
+	if (entries->readFromFile(*i)) {
 	  errs() << "success\n";
 	} else {
 	  errs() << "failed\n";
 	}
       }
-      //errs() << "Searching for external symbols starting from "
-      //       << "entries given by the interfaces of other modules:\n";
-      for (ComponentInterface::FunctionIterator i = ci.begin(), e = ci.end(); i != e; ++i) {
-	if (Function* f = M.getFunction(i->first())) {
-	  // errs() << "\tAdded " << f->getName() << "into the queue.\n";	  
-	  queue.push_back(cg.getOrInsertFunction(f));
-	}
-      }
-    } else {
-      //errs() << "Searching for external symbols starting from non-internal and "
-      //       << "address-taken functions:\n";
-      queue.push_back(cg.getExternalCallingNode());
     }
-    
-    std::set<CallGraphNode*> visited;
-    while (!queue.empty()) {
-      CallGraphNode* cgn = queue.back();
-      queue.pop_back();
-      
-      if (cgn->getFunction() && !isInternal(cgn->getFunction())) {
-	// this is a declaration and doesn't have any calls
-	continue;
-      }
-      
-      if (cgn == cg.getCallsExternalNode()) {
-	// In this case, we're here from a call that we can't resolve,
-	// so we need to be conservative.
-	// Everything that could have made it into this set is in the
-	// "External Calling" node, i.e. can be called externally
-	// - stored in a variable or externally visible
-	// NOTE: for this to be useful, we're going to need to minimize
-	// the size of the "externally visible" set.
-	cgn = cg.getExternalCallingNode();
-	if (visited.find(cgn) != visited.end()) {
-	  continue;
-	}
-      }
-      
-      for (auto &callRecord : *cgn) {
-	Value *calledV = stripBitCast(callRecord.first);
-	if (!calledV) {
-	  /////
-	  // JN: I think we are here if cgn is cg.getExternalCallingNode()
-	  //////
-	  assert(cgn == cg.getExternalCallingNode());
-	  assert(callRecord.second->getFunction());	  
-	  interface.callAny(callRecord.second->getFunction());
-	} else {
-	  CallSite CS(calledV);
-	  const Function *callee = callRecord.second->getFunction();
-	  if (callee && !isInternal(callee)) {
-	    errs() << "External call to "
-		   << callRecord.second->getFunction()->getName() << "\n";
-	    // record in the interface a known external call
-	    interface.call(callee->getName(), CS.arg_begin(), CS.arg_end());
-	    continue;
-	  }
-	}
-	
-	if (visited.insert(cgn).second) {
-	  queue.push_back(callRecord.second);
+
+    if (GatherDeepInterfaceOpt) {
+      // The rest of modules are loaded in the context of M.
+      std::vector<std::unique_ptr<Module>> others;
+      std::vector<Module*> modules;
+      modules.push_back(&M);
+      for (const std::string& filename: GatherDeepInterfaceModules) {
+	SMDiagnostic err;
+	std::unique_ptr<Module> other = parseIRFile(filename, err, M.getContext());
+	if (!other) {
+	  err.print("GatherInterface", errs());
+	  report_fatal_error("[GatherInterface] failed to read " + Twine(filename));
 	}
+	modules.push_back(other.get());
+	others.push_back(std::move(other));
       }
-    }
-    
-    // functions
-    for (Function &F: llvm::make_range(M.begin(), M.end())) {
-      if (F.isDeclaration() && !F.isIntrinsic()) {
-	errs() << "Added reference to function " << F.getName() << "\n";
-	interface.reference(F.getName());
-      }
-    }
-    
-    // global variables
-    for (GlobalVariable &gv: M.globals()) {
-      if (gv.isDeclaration()) {
-	errs() << "Added reference to global " << gv.getName() << "\n";	
-	interface.reference(gv.getName());
+      if (!entries) {
+	errs() << "[GatherInterface] -Pdeep-interface without -Pinterface-entry\n";
+	entries.reset(new ComponentInterface());
       }
+      GatherDeepInterface(modules, *entries, interface);
+    } else {
+      GatherInterface(M, cg, entries.get(), interface);
     }
     
-    // aliases 
-    for (GlobalAlias &alias: M.aliases()) {
-      if (alias.isDeclaration()) {
-	errs() << "Added reference to alias " << alias.getName() << "\n";		
-	interface.reference(alias.getName());
+    if (unsigned maxCalls = getInterfaceMaxCalls()) {
+      unsigned folded = interface.compact(maxCalls);
+      if (folded > 0) {
+	errs() << "[GatherInterface] folded " << folded << " calls\n";
       }
     }
-    
+
     if (GatherInterfaceOutput != "") {
-      proto::ComponentInterface ci;
-      codeInto<ComponentInterface, proto::ComponentInterface>(interface, ci);
-      std::ofstream output(GatherInterfaceOutput.c_str(), std::ios::binary);
-      assert(output.good());
-      bool success = ci.SerializeToOstream(&output);
+      bool success = writeInterfaceFile(interface, GatherInterfaceOutput);
       if (!success) {
 	errs() << "[GatherInterface] failed to write out interface\n";
 	assert(false && "failed to write out interface");
       }
-      output.close();
     }
     
     return false;
@@ -40,11 +40,13 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
-#include "PrevirtualizeInterfaces.h"
+#include "Previrtualize.h"
+#include "MappedInterface.h"
 #include "Specializer.h"
 
 #include <vector>
 #include <string>
+#include <memory>
 
 using namespace llvm;
 
@@ -155,6 +157,9 @@ namespace previrt
   public:
     
     ComponentInterfaceTransform transform;
+    // rewrite files in the mapped format are queried in place for the
+    // functions that the module calls
+    std::vector<std::unique_ptr<MappedInterface>> mapped;
     static char ID;
     
   public:
@@ -167,7 +172,11 @@ namespace previrt
       for (cl::list<std::string>::const_iterator b = RewriteComponentInput.begin(),
 	     e = RewriteComponentInput.end(); b != e; ++b) {
         errs() << "Reading file '" << *b << "'...";
-        if (transform.readTransformFromFile(*b)) {
+        std::unique_ptr<MappedInterface> m = MappedInterface::open(*b);
+        if (m && m->isTransform()) {
+          mapped.push_back(std::move(m));
+          errs() << "success (mapped)\n";
+        } else if (transform.readTransformFromFile(*b)) {
           errs() << "success\n";
         } else {
           errs() << "failed\n";
@@ -180,6 +189,17 @@ namespace previrt
     virtual ~InterRewriterPass() {}
     
     virtual bool runOnModule(Module& M) {
+      if (!mapped.empty()) {
+        // -- only the rewrites of the functions that M declares are decoded
+        for (const Function& f: M) {
+          if (!f.isDeclaration()) continue;
+          for (auto& m: mapped) {
+            m->readCallsInto(f.getName(), transform);
+          }
+        }
+        transform.compile();
+      }
+
       if (!transform.interface) {
         return false;
       }
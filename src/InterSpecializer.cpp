@@ -47,7 +47,8 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
-#include "PrevirtualizeInterfaces.h"
+#include "Previrtualize.h"
+#include "MappedInterface.h"
 #include "Specializer.h"
 #include "SpecializationPolicy.h"
 /* here specialization policies */
@@ -55,6 +56,11 @@
 #include "RecursiveGuardSpecPolicy.h"
 #include "BoundedSpecPolicy.h"
 #include "OnlyOnceSpecPolicy.h"
+#include "ProfitableSpecPolicy.h"
+#include "SpecializationBudget.h"
+#include "SpecializationTable.h"
+#include "SpecializationMerger.h"
+#include "analysis/ProfileCounts.h"
 
 #include <vector>
 #include <string>
@@ -76,7 +82,9 @@ SpecPolicy("Pspecialize-policy",
 	clEnumValN(previrt::SpecializationPolicyType::BOUNDED, "bounded",
 		   "Always specialize if number of copies so far <= Ppeval-max-spec-copies"),
 	clEnumValN(previrt::SpecializationPolicyType::NONREC, "nonrec-aggressive",
-		   "Specialize always if some constant arg and function is non-recursive")),
+		   "Specialize always if some constant arg and function is non-recursive"),
+	clEnumValN(previrt::SpecializationPolicyType::PROFITABLE, "profitable",
+		   "Specialize if function is non-recursive and the constant args simplify at least -Pspecialize-profit-ratio percent of it")),
         cl::init(previrt::SpecializationPolicyType::NONREC));
 
 static cl::opt<unsigned>
@@ -84,6 +92,26 @@ MaxSpecCopies("Pspecialize-max-bounded",
 	   cl::init(5),
 	   cl::desc("Maximum number of copies for a function if -Pspecialize-policy=bounded"));
 
+static cl::opt<unsigned>
+ProfitRatio("Pspecialize-profit-ratio",
+	    cl::init(10),
+	    cl::desc("Minimum estimated savings (in percent of the function size) if -Pspecialize-policy=profitable"));
+
+static cl::opt<bool>
+Merge("Pspecialize-merge",
+      cl::init(true),
+      cl::desc("Fold the specializations that are structurally identical"));
+
+static cl::opt<unsigned>
+HotPercent("Pspecialize-hot-percent",
+	   cl::init(1),
+	   cl::desc("If the module has a profile, specialize only the functions that run at least this percent as often as its hottest function"));
+
+static cl::opt<unsigned>
+Budget("Pspecialize-budget",
+       cl::init(0),
+       cl::desc("Instructions that all the specializations of a module may add, in percent of its size when first specialized (0 for no limit)"));
+
 static cl::list<std::string>
 SpecCompIn("Pspecialize-input",
 	   cl::NotHidden,
@@ -119,13 +147,87 @@ namespace previrt
    * Generate a ComponentInterfaceTransform for clients to rewrite their
    * code to use the new API
    */
-  static bool SpecializeComponent(Module& M, ComponentInterfaceTransform& T,
-				  SpecializationPolicy& policy,
-				  std::vector<Function*>& to_add) {
+  static unsigned instructionCount(const Function& f) {
+    unsigned count = 0;
+    for (const BasicBlock& bb: f) {
+      count += bb.size();
+    }
+    return count;
+  }
+
+  /* A call in the interface that the policy agreed to specialize */
+  struct InterCandidate {
+    // index of the module that defines func
+    unsigned module;
+    Function* func;
+    StringRef name;
+    const CallInfo* call;
+    // marks[i] is true iff the i-th argument is a specializable constant
+    SmallBitVector marks;
+  };
+
+  /* A module being specialized by SpecializeComponents */
+  struct InterModule {
+    Module* M;
+    ComponentInterfaceTransform* T;
+    // -- Specializations made so far, also by earlier runs
+    std::unique_ptr<SpecializationTable> table;
+    std::unique_ptr<SpecializationPolicy> policy;
+    // new functions to add to M
+    std::vector<Function*> to_add;
+    unsigned rewrite_count;
+  };
+
+  static std::unique_ptr<SpecializationPolicy>
+  createPolicy(Module& M, SpecializationTable& table, CallGraph& cg,
+	       const SpecializeOptions& options) {
+    std::unique_ptr<SpecializationPolicy> policy;
+    switch (options.policy) {
+    case SpecializationPolicyType::NOSPECIALIZE:
+      break;
+    case SpecializationPolicyType::AGGRESSIVE:
+      policy.reset(new AggressiveSpecPolicy());
+      break;
+    case SpecializationPolicyType::BOUNDED: {
+      std::unique_ptr<SpecializationPolicy> subpolicy =
+	llvm::make_unique<AggressiveSpecPolicy>();
+      policy.reset(new BoundedSpecPolicy(M, table, std::move(subpolicy), options.maxBounded));
+      break;
+    }
+    case SpecializationPolicyType::ONLY_ONCE:
+      policy.reset(new OnlyOnceSpecPolicy(table));
+      break;
+    case SpecializationPolicyType::NONREC: {
+      std::unique_ptr<SpecializationPolicy> subpolicy =
+	llvm::make_unique<AggressiveSpecPolicy>();
+      policy.reset(new RecursiveGuardSpecPolicy(std::move(subpolicy), cg));
+      break;
+    }
+    case SpecializationPolicyType::PROFITABLE: {
+      std::unique_ptr<SpecializationPolicy> subpolicy =
+	llvm::make_unique<RecursiveGuardSpecPolicy>(llvm::make_unique<AggressiveSpecPolicy>(), cg);
+      policy.reset(new ProfitableSpecPolicy(std::move(subpolicy), options.profitRatio));
+      break;
+    }
+    default:;;
+    }
+    return policy;
+  }
+
+  /* Add to candidates the calls in the interface of m.T that m.policy
+     agrees to specialize */
+  static void collectCandidates(unsigned module, InterModule& m,
+				unsigned hotPercent,
+				std::vector<InterCandidate>& candidates) {
     errs() << "SpecializeComponent()\n";
+    Module& M = *m.M;
+
+    // The profile of M only has the counts of its own functions, so a
+    // call from another module is as hot as the function it calls.
+    analysis::ProfileCounts profile(M);
+    unsigned cold = 0;
 
-    int rewrite_count = 0;
-    const ComponentInterface& I = T.getInterface();
+    const ComponentInterface& I = m.T->getInterface();
     // TODO: What needs to be done?
     // - Should try to handle strings & arrays
     // Iterate through all functions in the interface of T
@@ -138,6 +240,11 @@ namespace previrt
         continue;
       }
 
+      if (!profile.isHot(*func, hotPercent)) {
+	cold++;
+	continue;
+      }
+
       // Now iterate through all calls to func in the interface of T
       for (ComponentInterface::CallIterator cc = I.call_begin(name), ce =
           I.call_end(name); cc != ce; ++cc) {
@@ -158,69 +265,217 @@ namespace previrt
 	  indicate whether the argument is a specializable constant
 	 */
         SmallBitVector marks(arg_count);
-        bool shouldSpecialize = policy.interSpecializeOn(*func, call->args, I, marks);
+        bool shouldSpecialize = m.policy->interSpecializeOn(*func, call->args, I, marks);
 						     
 
         if (!shouldSpecialize)
           continue;
 
-        std::vector<Value*> args;
-        std::vector<unsigned> argPerm;
-        args.reserve(arg_count);
-        argPerm.reserve(marks.count());
-        for (unsigned i = 0; i < arg_count; i++) {
-          if (marks.test(i)) {
-	      Type * paramType = func->getFunctionType()->getParamType(i);
-	      Value *concreteArg = call->args[i].concretize(M, paramType);
-	      args.push_back(concreteArg);
-	      assert(concreteArg->getType() == paramType
-		     && "Specializing function with concrete argument of wrong type!");
-          } else {
-            args.push_back(nullptr);
-            argPerm.push_back(i);
-          }
-        }
-	
-	/*
-	  args is a list of pointers to values
-	   -- if the pointer is nullptr then that argument is not
-               specialized.
-	   -- if the pointer is not nullptr then the argument will be/has
-              been specialized to that value.
-
-	  argsPerm is a list on integers; the indices of the non-special arguments
-	  args[i] = nullptr iff i is in argsPerm for i < arg_count.
-	*/
-
-        Function* specialized_func = specializeFunction(func, args);
-	if (!specialized_func) {
-	  continue;
-	}
-        specialized_func->setLinkage(GlobalValue::ExternalLinkage);
-        FunctionHandle rewriteTo = specialized_func->getName();
-        T.rewrite(name, call, rewriteTo, argPerm);
-        to_add.push_back(specialized_func);
-	errs() << "Specialized  " << name << " to " << rewriteTo << "\n";
-
-        #if 0
-	for (unsigned i = 0; i < arg_count; i++) {
-	  errs() << "i = " << i << ": marks[i] = " << marks[i]
-		 << " args[i] = " << args.at(i) << "\n";
-	}
-	errs() << " argPerm = [";
-	for (unsigned i = 0; i < argPerm.size(); i++) {
-	  errs() << argPerm.at(i) << " ";
+	candidates.push_back({module, func, name, call, std::move(marks)});
+      }
+    }
+    if (profile.hasProfile()) {
+      errs() << cold << " cold functions skipped\n";
+    }
+  }
+
+  /* Specialize the call of c (or reuse an earlier copy) and record
+     the rewrite in m.T. Return false if it was not specialized. */
+  static bool specializeCandidate(InterModule& m, const InterCandidate& c,
+				  uint64_t cost, SpecializationBudget& budget,
+				  unsigned& over_budget) {
+    Module& M = *m.M;
+    Function* func = c.func;
+    const CallInfo* const call = c.call;
+    const SmallBitVector& marks = c.marks;
+    const unsigned arg_count = call->args.size();
+
+    std::vector<Value*> args;
+    std::vector<unsigned> argPerm;
+    args.reserve(arg_count);
+    argPerm.reserve(marks.count());
+    for (unsigned i = 0; i < arg_count; i++) {
+      if (marks.test(i)) {
+	Type * paramType = func->getFunctionType()->getParamType(i);
+	Value *concreteArg = call->args[i].concretize(M, paramType);
+	args.push_back(concreteArg);
+	assert(concreteArg->getType() == paramType
+	       && "Specializing function with concrete argument of wrong type!");
+      } else {
+	args.push_back(nullptr);
+	argPerm.push_back(i);
+      }
+    }
+
+    /*
+      args is a list of pointers to values
+      -- if the pointer is nullptr then that argument is not
+      specialized.
+      -- if the pointer is not nullptr then the argument will be/has
+      been specialized to that value.
+
+      argsPerm is a list on integers; the indices of the non-special arguments
+      args[i] = nullptr iff i is in argsPerm for i < arg_count.
+    */
+
+    // -- reuse the copy made by an earlier run for exactly args
+    Function* specialized_func = nullptr;
+    if (const SpecializationTable::Specialization* version =
+	m.table->lookupSpecialization(func, args)) {
+      specialized_func = version->handle;
+    } else {
+      if (!budget.canAfford(cost)) {
+	over_budget++;
+	return false;
+      }
+      specialized_func = specializeFunction(func, args);
+      if (!specialized_func) {
+	return false;
+      }
+      if (m.table->addSpecialization(func, args, specialized_func)) {
+	budget.spend(cost);
+      }
+    }
+    specialized_func->setLinkage(GlobalValue::ExternalLinkage);
+    FunctionHandle rewriteTo = specialized_func->getName();
+    m.T->rewrite(c.name, call, rewriteTo, argPerm);
+    m.to_add.push_back(specialized_func);
+    errs() << "Specialized  " << c.name << " to " << rewriteTo << "\n";
+    return true;
+  }
+
+  /* Add the new functions to the module and fold the identical ones */
+  static bool finishComponent(InterModule& m, const SpecializeOptions& options) {
+    Module& M = *m.M;
+    bool modified = m.rewrite_count > 0;
+    if (m.rewrite_count > 0) {
+      errs() << m.rewrite_count << " pending rewrites\n";
+    }
+
+    /*
+       adding the "new" specialized definitions (in to_add) to M;
+       the caller (opt or occam-slash) is responsible for writing out M
+    */
+    Module::FunctionListType &functionList = M.getFunctionList();
+    while (!m.to_add.empty()) {
+      Function *add = m.to_add.back();
+      m.to_add.pop_back();
+      if (add->getParent() == &M) {
+	// Already in module
+	continue;
+      } else {
+	errs() << "Adding \"" << add->getName() << "\" to the module.\n";
+	functionList.push_back(add);
+      }
+    }
+
+    // -- The copies of the arguments that a function ignores are the
+    //    same. The other modules must call the one that is kept.
+    if (options.merge) {
+      std::map<std::string, std::string> folded;
+      if (mergeSpecializations(M, *m.table, folded) > 0) {
+	for (auto& kv: folded) {
+	  // otherwise the alias with the old name is called
+	  Function* kept = M.getFunction(kv.second);
+	  if (kept && !kept->hasLocalLinkage()) {
+	    m.T->retarget(kv.first, kv.second);
+	  }
 	}
-	errs() << "]\n";
-        #endif
+	errs() << folded.size() << " identical functions merged\n";
+	modified = true;
+      }
+    }
+    return modified;
+  }
 
-       rewrite_count++;
+  SpecializeOptions getSpecializeOptions() {
+    SpecializeOptions options;
+    options.policy = SpecPolicy;
+    options.maxBounded = MaxSpecCopies;
+    options.profitRatio = ProfitRatio;
+    options.budget = Budget;
+    options.hotPercent = HotPercent;
+    options.merge = Merge;
+    return options;
+  }
+
+  bool SpecializeComponent(Module& M, ComponentInterfaceTransform& T,
+			   CallGraph& cg) {
+    return SpecializeComponent(M, T, cg, getSpecializeOptions());
+  }
+
+  bool SpecializeComponent(Module& M, ComponentInterfaceTransform& T,
+			   CallGraph& cg, const SpecializeOptions& options) {
+    if (options.policy == SpecializationPolicyType::NOSPECIALIZE) {
+      return false;
+    }
+    if (options.sharedBudget) {
+      return SpecializeComponents({&M}, {&T}, {&cg}, options, *options.sharedBudget);
+    }
+    SpecializationBudget budget(M, options.budget);
+    bool modified = SpecializeComponents({&M}, {&T}, {&cg}, options, budget);
+    budget.save();
+    return modified;
+  }
+
+  bool SpecializeComponents(const std::vector<Module*>& modules,
+			    const std::vector<ComponentInterfaceTransform*>& transforms,
+			    const std::vector<CallGraph*>& cgs,
+			    const SpecializeOptions& options,
+			    SpecializationBudget& budget) {
+    assert(modules.size() == transforms.size() && modules.size() == cgs.size());
+
+    std::vector<InterModule> state(modules.size());
+    std::vector<InterCandidate> candidates;
+    for (unsigned i = 0, e = modules.size(); i < e; ++i) {
+      InterModule& m = state[i];
+      m.M = modules[i];
+      m.T = transforms[i];
+      m.table.reset(new SpecializationTable(m.M));
+      m.rewrite_count = 0;
+      // -- Create the specialization policy. Bail out if no policy.
+      m.policy = createPolicy(*m.M, *m.table, *cgs[i], options);
+      if (!m.policy) {
+	return false;
       }
+      collectCandidates(i, m, options.hotPercent, candidates);
     }
-    if (rewrite_count > 0) {
-      errs() << rewrite_count << " pending rewrites\n";
+
+    // -- With a budget, the specializations with the best estimated
+    //    savings per copied instruction go first, whatever module
+    //    they are in.
+    std::vector<SpecializationBudget::Candidate> ranking;
+    ranking.reserve(candidates.size());
+    for (unsigned i = 0, e = candidates.size(); i < e; ++i) {
+      const InterCandidate& c = candidates[i];
+      if (budget.isLimited()) {
+	ranking.push_back({instructionCount(*c.func),
+	      1 + ProfitableSpecPolicy::estimateSavings(*c.func, c.call->args, c.marks), i});
+      } else {
+	ranking.push_back({0, 0, i});
+      }
+    }
+    SpecializationBudget::rank(ranking);
+
+    unsigned over_budget = 0;
+    for (const SpecializationBudget::Candidate& r: ranking) {
+      const InterCandidate& c = candidates[r.id];
+      InterModule& m = state[c.module];
+      if (specializeCandidate(m, c, r.cost, budget, over_budget)) {
+	m.rewrite_count++;
+      }
+    }
+    if (budget.isLimited()) {
+      errs() << "Specialization budget: " << budget.spent() << " of "
+	     << budget.total() << " instructions spent, " << over_budget
+	     << " calls skipped\n";
+    }
+
+    bool modified = false;
+    for (InterModule& m: state) {
+      modified |= finishComponent(m, options);
     }
-    return rewrite_count > 0;
+    return modified;
   }
 }
 
@@ -230,6 +485,9 @@ namespace previrt {
   public:
     
     ComponentInterfaceTransform transform;
+    // interfaces in the mapped format are queried in place for the
+    // functions of the module
+    std::vector<std::unique_ptr<MappedInterface>> mapped;
     static char ID;
 
   public:
@@ -241,7 +499,11 @@ namespace previrt {
       for (cl::list<std::string>::const_iterator b = SpecCompIn.begin(),
 	     e = SpecCompIn.end(); b != e; ++b) {
         errs() << "Reading file '" << *b << "'...";
-        if (transform.readInterfaceFromFile(*b)) {
+        std::unique_ptr<MappedInterface> m = MappedInterface::open(*b);
+        if (m && !m->isTransform()) {
+          mapped.push_back(std::move(m));
+          errs() << "success (mapped)\n";
+        } else if (transform.readInterfaceFromFile(*b)) {
           errs() << "success\n";
         } else {
           errs() << "failed\n";
@@ -259,73 +521,36 @@ namespace previrt {
     virtual ~InterSpecializerPass() {}
           
     virtual bool runOnModule(Module& M) {    
-      if (!transform.interface) {
-	return false;
+      if (!mapped.empty()) {
+	// -- only the calls to the functions that M defines are decoded
+	for (const Function& f: M) {
+	  if (f.isDeclaration()) continue;
+	  for (auto& m: mapped) {
+	    m->readCallsInto(f.getName(), transform);
+	  }
+	}
+	for (const GlobalAlias& a: M.aliases()) {
+	  for (auto& m: mapped) {
+	    m->readCallsInto(a.getName(), transform);
+	  }
+	}
+	transform.compile();
       }
 
-      // -- Create the specialization policy. Bail out if no policy.
-      std::unique_ptr<SpecializationPolicy> policy;
-      switch (SpecPolicy) {
-      case SpecializationPolicyType::NOSPECIALIZE:
-	return false;
-      case SpecializationPolicyType::AGGRESSIVE:
-	policy.reset(new AggressiveSpecPolicy());
-	break;
-      case SpecializationPolicyType::BOUNDED: {
-	std::unique_ptr<SpecializationPolicy> subpolicy =
-	  llvm::make_unique<AggressiveSpecPolicy>();
-	policy.reset(new BoundedSpecPolicy(M, std::move(subpolicy), MaxSpecCopies));
-	break;
-      }
-      case SpecializationPolicyType::ONLY_ONCE:
-	policy.reset(new OnlyOnceSpecPolicy());
-	break;
-      case SpecializationPolicyType::NONREC: {
-	std::unique_ptr<SpecializationPolicy> subpolicy =
-	  llvm::make_unique<AggressiveSpecPolicy>();
-	CallGraph& cg = getAnalysis<CallGraphWrapperPass>().getCallGraph();      
-	policy.reset(new RecursiveGuardSpecPolicy(std::move(subpolicy), cg));
-      break;
-      }
-      default:;;
-      }
-      
-      if (!policy) {
+      if (!transform.interface) {
 	return false;
       }
-      
+
       errs() << "InterSpecializerPass::runOnModule(): " << M.getModuleIdentifier() << "\n";
-      std::vector<Function*> to_add;
-      bool modified = SpecializeComponent(M, transform, *policy, to_add);
-      
-      /*
-	 adding the "new" specialized definitions (in to_add) to M;
-	 opt will write out M to the -o argument to the "python call"
-      */
-      Module::FunctionListType &functionList = M.getFunctionList();
-      while (!to_add.empty()) {
-	Function *add = to_add.back();
-	to_add.pop_back();
-	if (add->getParent() == &M) {
-	  // Already in module
-	  continue;
-	} else {
-	  errs() << "Adding \"" << add->getName() << "\" to the module.\n";
-	  functionList.push_back(add);
-	}
-      }
+      CallGraph& cg = getAnalysis<CallGraphWrapperPass>().getCallGraph();
+      bool modified = SpecializeComponent(M, transform, cg);
 
       /* writing the output ("rw" rewrite file) to the -Pspecialize-output argument */
       if (SpecCompOut != "") {
-        proto::ComponentInterfaceTransform buf;
-        codeInto(this->transform, buf);
-        std::ofstream output(SpecCompOut.c_str(),
-			     std::ios::binary | std::ios::trunc);
-	bool success = buf.SerializeToOstream(&output);
+	bool success = writeTransformFile(this->transform, SpecCompOut);
 	if (!success) {
 	  assert (false && "failed to write out interface");
 	}
-        output.close();
       }
       
       return modified;
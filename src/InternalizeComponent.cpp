@@ -41,11 +41,13 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
-#include "PrevirtualizeInterfaces.h"
+#include "Previrtualize.h"
+#include "MappedInterface.h"
 
 #include <vector>
 #include <string>
 #include <fstream>
+#include <memory>
 
 using namespace llvm;
 
@@ -150,31 +152,81 @@ static bool setInternalLinkage(GlobalValue &GV) {
 }
 
 /*
- * Remove all code from the given module that is not necessary to
- * implement the given interface.
+ * The union of an interface in memory and of interfaces in the mapped
+ * format, which are queried in place.
  */
-bool MinimizeComponent(Module& M, const ComponentInterface& I) {
-  
-  errs() << "InternalizePass::runOnModule: " << M.getModuleIdentifier() << "\n";
-  
-  bool modified = false;
-  // for stats
-  int internalized_functions = 0;
-  int internalized_globals = 0;
-  
-  std::set<std::string> keep_external;
+class InterfaceQuery {
+  const ComponentInterface& I;
+  const std::vector<std::unique_ptr<MappedInterface>>& mapped;
+
+public:
+  InterfaceQuery(const ComponentInterface& I,
+		 const std::vector<std::unique_ptr<MappedInterface>>& mapped)
+    : I(I), mapped(mapped) {}
+
+  bool isCalled(StringRef name) const {
+    if (I.calls.find(name) != I.calls.end()) return true;
+    for (auto &m: mapped) {
+      if (m->findFunction(name) >= 0) return true;
+    }
+    return false;
+  }
+
+  bool isReferenced(StringRef name) const {
+    if (I.references.find(name) != I.references.end()) return true;
+    for (auto &m: mapped) {
+      if (m->isReferenced(name)) return true;
+    }
+    return false;
+  }
+};
+
+static bool minimizeComponent(Module& M, const InterfaceQuery& I,
+			      const MinimizeOptions& options);
+
+MinimizeOptions getMinimizeOptions() {
+  MinimizeOptions options;
+  options.fixpointThreshold = FixpointTreshold;
   if (KeepExternalFile != "") {
     std::ifstream infile(KeepExternalFile);
     if (infile.is_open()) {
       std::string line;
       while (std::getline(infile, line)) {
-	keep_external.insert(line);
+	options.keepExternal.insert(line);
       }
       infile.close();
     } else {
       errs() << "Warning: ignored whitelist because something failed.\n";
     }
   }
+  return options;
+}
+
+/*
+ * Remove all code from the given module that is not necessary to
+ * implement the given interface.
+ */
+bool MinimizeComponent(Module& M, const ComponentInterface& I,
+		       const MinimizeOptions& options) {
+  std::vector<std::unique_ptr<MappedInterface>> none;
+  return minimizeComponent(M, InterfaceQuery(I, none), options);
+}
+
+bool MinimizeComponent(Module& M, const ComponentInterface& I) {
+  return MinimizeComponent(M, I, getMinimizeOptions());
+}
+
+static bool minimizeComponent(Module& M, const InterfaceQuery& I,
+			      const MinimizeOptions& options) {
+  
+  errs() << "InternalizePass::runOnModule: " << M.getModuleIdentifier() << "\n";
+  
+  bool modified = false;
+  // for stats
+  int internalized_functions = 0;
+  int internalized_globals = 0;
+  
+  const std::set<std::string>& keep_external = options.keepExternal;
 
   // If we cannot internalize an alias we shouldn't either its
   // aliasee.
@@ -190,7 +242,7 @@ bool MinimizeComponent(Module& M, const ComponentInterface& I) {
       continue;
     }
     
-    if (I.references.find(alias.getName()) == I.references.end() && alias.use_empty()) {
+    if (!I.isReferenced(alias.getName()) && alias.use_empty()) {
       errs() << "Remove unused alias " << alias.getName() << "\n";
       unusedAliases.push_back(&alias);
     } else {
@@ -218,8 +270,8 @@ bool MinimizeComponent(Module& M, const ComponentInterface& I) {
 	// f is discardable if unused in other compilation units
 	isDiscardableIfUnusedExternally(f.getLinkage()) && 
 	// unused in other compilation units
-	I.calls.find(f.getName()) == I.calls.end() &&
-	I.references.find(f.getName()) == I.references.end() &&
+	!I.isCalled(f.getName()) &&
+	!I.isReferenced(f.getName()) &&
 	// The address of f has not been taken
 	!f.hasAddressTaken() &&	
 	// there is no an alias to f that we want to keep
@@ -257,7 +309,7 @@ bool MinimizeComponent(Module& M, const ComponentInterface& I) {
     
     if (gv.hasInitializer() &&
 	// global is unused
-	I.references.find(gv.getName()) == I.references.end() && 
+	!I.isReferenced(gv.getName()) && 
 	isDiscardableIfUnusedExternally(gv.getLinkage()) &&
 	// there is no an alias to f that we want to keep
 	!keepAliasees.count(&gv)) {
@@ -297,7 +349,7 @@ bool MinimizeComponent(Module& M, const ComponentInterface& I) {
   bool change_mc = false;
   unsigned int iters = 0;
     
-  while (moreToDo && iters < FixpointTreshold) {
+  while (moreToDo && iters < options.fixpointThreshold) {
     change_dce = dceMgr.run(M);
     change_mc = mcMgr.run(M);
     moreToDo = (change_dce || change_mc);
@@ -321,6 +373,8 @@ bool MinimizeComponent(Module& M, const ComponentInterface& I) {
 class InternalizePass : public ModulePass {
 public:
   ComponentInterface interface;
+  // interfaces in the mapped format are not read but queried in place
+  std::vector<std::unique_ptr<MappedInterface>> mapped;
   static char ID;
   
 public:
@@ -329,7 +383,11 @@ public:
     errs() << "InternalizePass()\n";
     for (std::string input: InterfaceInput) {
       errs() << "Reading file '" << input << "'...";
-      if (interface.readFromFile(input)) {
+      std::unique_ptr<MappedInterface> m = MappedInterface::open(input);
+      if (m && !m->isTransform()) {
+	mapped.push_back(std::move(m));
+	errs() << "success (mapped)\n";
+      } else if (interface.readFromFile(input)) {
 	errs() << "success\n";
       } else {
 	errs() << "failed\n";
@@ -341,7 +399,8 @@ public:
   virtual ~InternalizePass() {}
   
   virtual bool runOnModule(Module& M) {
-    return MinimizeComponent(M, interface);
+    return minimizeComponent(M, InterfaceQuery(interface, mapped),
+			     getMinimizeOptions());
   }
 };
 
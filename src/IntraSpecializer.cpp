@@ -36,6 +36,8 @@
  **/
 
 #include "llvm/Pass.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Function.h"
@@ -47,15 +49,21 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 
+#include "Previrtualize.h"
 #include "SpecializationTable.h"
+#include "SpecializationMerger.h"
 #include "Specializer.h"
 /* here specialization policies */
 #include "AggressiveSpecPolicy.h"
 #include "RecursiveGuardSpecPolicy.h"
 #include "BoundedSpecPolicy.h"
 #include "OnlyOnceSpecPolicy.h"
+#include "ProfitableSpecPolicy.h"
+#include "SpecializationBudget.h"
+#include "analysis/ProfileCounts.h"
 
 using namespace llvm;
 using namespace previrt;
@@ -73,7 +81,9 @@ SpecPolicy("Ppeval-policy",
 	clEnumValN(SpecializationPolicyType::BOUNDED, "bounded",
 		   "Always specialize if number of copies so far <= Ppeval-max-spec-copies"),
 	clEnumValN(SpecializationPolicyType::NONREC, "nonrec-aggressive",
-		   "Specialize always if some constant arg and function is non-recursive")),
+		   "Specialize always if some constant arg and function is non-recursive"),
+	clEnumValN(SpecializationPolicyType::PROFITABLE, "profitable",
+		   "Specialize if function is non-recursive and the constant args simplify at least -Ppeval-profit-ratio percent of it")),
 	cl::init(SpecializationPolicyType::NONREC));
 
 static cl::opt<unsigned>
@@ -81,22 +91,66 @@ MaxSpecCopies("Ppeval-max-bounded",
 	      cl::init(5),
 	      cl::desc("Maximum number of copies for a function if -Ppeval-policy=bounded"));
 
+static cl::opt<unsigned>
+ProfitRatio("Ppeval-profit-ratio",
+	    cl::init(10),
+	    cl::desc("Minimum estimated savings (in percent of the function size) if -Ppeval-policy=profitable"));
+
 static cl::opt<bool>
 OptSpecialized("Ppeval-opt",
 	       cl::init(false),
-	       cl::desc("Optimize new specialized functions"));
+	       cl::desc("Optimize new specialized functions and their callers"));
+
+static cl::opt<unsigned>
+MaxRounds("Ppeval-max-rounds",
+	  cl::init(10),
+	  cl::desc("Maximum number of rounds of specialization of the new functions"));
+
+static cl::opt<unsigned>
+MaxGrowth("Ppeval-max-growth",
+	  cl::init(0),
+	  cl::desc("Stop the rounds when the code has grown more than this percent (0 for no limit)"));
+
+static cl::opt<bool>
+Merge("Ppeval-merge",
+      cl::init(true),
+      cl::desc("Fold the specializations that are structurally identical"));
+
+static cl::opt<unsigned>
+HotPercent("Ppeval-hot-percent",
+	   cl::init(1),
+	   cl::desc("If the module has a profile, specialize only the call sites that run at least this percent as often as its hottest function"));
+
+static cl::opt<unsigned>
+Budget("Ppeval-budget",
+       cl::init(0),
+       cl::desc("Instructions that all the specializations of a module may add, in percent of its size when first specialized (0 for no limit)"));
 
 
 namespace previrt {
 
+/* A call site that the policy agreed to specialize */
+struct IntraCandidate {
+  Instruction* call;
+  // scheme[i] = nullptr if the i-th parameter of the callsite
+  //                     cannot be specialized.
+  //             c if the i-th parameter of the callsite is a
+  //               constant c
+  std::vector<Value*> scheme;
+};
+
 /**
-   Return true if any callsite in f is specialized using policy.
+   Add to candidates the callsites in f that should be specialized
+   according to policy. Return the number of callsites skipped
+   because they are cold.
 **/
-static bool trySpecializeFunction(Function* f, SpecializationTable& table,
-				  SpecializationPolicy& policy,
-				  std::vector<Function*>& to_add) {
+static unsigned collectCandidates(Function* f, SpecializationPolicy& policy,
+				  analysis::ProfileCounts& profile,
+				  unsigned hotPercent,
+				  std::vector<IntraCandidate>& candidates) {
   
   std::vector<Instruction*> worklist;
+  unsigned cold = 0;
   for (BasicBlock& bb: *f) {
     for (Instruction& I: bb) {
 
@@ -121,12 +175,16 @@ static bool trySpecializeFunction(Function* f, SpecializationTable& table,
       if (callee->hasFnAttribute(Attribute::OptimizeNone)) {
         continue;
       }
+
+      if (!profile.isHot(*CI, hotPercent)) {
+	cold++;
+	continue;
+      }
       
       worklist.push_back(CS.getInstruction());
     }
   }
 
-  bool modified = false;  
   while (!worklist.empty()) {
     Instruction* ci = worklist.back();
     worklist.pop_back();
@@ -138,99 +196,114 @@ static bool trySpecializeFunction(Function* f, SpecializationTable& table,
       // We only try to specialize a function if it's internal. 
       continue;
     }
-    // specScheme[i] = nullptr if the i-th parameter of the callsite
-    //                         cannot be specialized.
-    //                 c if the i-th parameter of the callsite is a
-    //                   constant c
     std::vector<Value*> specScheme;
     bool specialize = policy.intraSpecializeOn(cs, specScheme);
           
     if (!specialize) {
       continue;
     }
+    candidates.push_back({ci, std::move(specScheme)});
+  }
+  return cold;
+}
 
-    #if 1
-    errs() << "Intra-specializing call to '" << callee->getName()
-	   << "' in function '" << ci->getParent()->getParent()->getName()
-	   << "' on arguments [";
-    for (unsigned int i = 0, cnt = 0; i < callee->arg_size(); ++i) {
-      if (specScheme[i] != NULL) {
-	if (cnt++ != 0) {
-	  errs() << ",";
-	}
-	if (GlobalValue* gv =
-	    dyn_cast<GlobalValue>(cs.getInstruction()->getOperand(i))) {
-	  errs() << i << "=(@" << gv->getName() << ")";
-	} else {
-	  errs() << i << "=(" << *cs.getInstruction()->getOperand(i) << ")";
-	}
+/**
+   Rewrite the callsite of candidate to call a specialized copy of
+   the callee. Return false if the copy cannot be built.
+**/
+static bool specializeCandidate(IntraCandidate& candidate,
+				SpecializationTable& table,
+				std::vector<Function*>& to_add) {
+  Instruction* ci = candidate.call;
+  std::vector<Value*>& specScheme = candidate.scheme;
+  CallSite cs(ci);
+  Function* callee = cs.getCalledFunction();
+
+  #if 1
+  errs() << "Intra-specializing call to '" << callee->getName()
+	 << "' in function '" << ci->getParent()->getParent()->getName()
+	 << "' on arguments [";
+  for (unsigned int i = 0, cnt = 0; i < callee->arg_size(); ++i) {
+    if (specScheme[i] != NULL) {
+      if (cnt++ != 0) {
+	errs() << ",";
       }
-    }
-    errs() << "]\n";
-    #endif
-        
-    // --- build a specialized function if specScheme is more
-    //     refined than all existing specialized versions.
-    Function* specialized_callee = nullptr;
-    std::vector<const SpecializationTable::Specialization*> versions;
-    table.getSpecializations(callee, specScheme, versions);
-    for (std::vector<const SpecializationTable::Specialization*>::iterator i =
-	   versions.begin(), e = versions.end(); i != e; ++i) {
-      if (SpecializationTable::Specialization::refines(specScheme, (*i)->args)) {
-	specialized_callee = (*i)->handle;
-	break;
+      if (GlobalValue* gv =
+	  dyn_cast<GlobalValue>(cs.getInstruction()->getOperand(i))) {
+	errs() << i << "=(@" << gv->getName() << ")";
+      } else {
+	errs() << i << "=(" << *cs.getInstruction()->getOperand(i) << ")";
       }
     }
+  }
+  errs() << "]\n";
+  #endif
+        
+  // --- build a specialized function unless there is already one
+  //     for exactly specScheme.
+  Function* specialized_callee = nullptr;
+  if (const SpecializationTable::Specialization* version =
+      table.lookupSpecialization(callee, specScheme)) {
+    specialized_callee = version->handle;
+  }
     
-    if (!specialized_callee) {
-      specialized_callee = specializeFunction(callee, specScheme);
-      if(!specialized_callee) {
-	continue;
-      }
-      table.addSpecialization(callee, specScheme, specialized_callee);
+  if (!specialized_callee) {
+    specialized_callee = specializeFunction(callee, specScheme);
+    if(!specialized_callee) {
+      return false;
+    }
+    if (table.addSpecialization(callee, specScheme, specialized_callee)) {
       to_add.push_back(specialized_callee);
     }
+  }
     
-    // -- build the specialized callsite
-    const unsigned int specialized_arg_count = specialized_callee->arg_size();
-    std::vector<unsigned> argPerm;
-    argPerm.reserve(specialized_arg_count);
-    for (unsigned from = 0; from < callee->arg_size(); from++) {
-      if (!specScheme[from]) {
-	argPerm.push_back(from);
-      }
+  // -- build the specialized callsite
+  const unsigned int specialized_arg_count = specialized_callee->arg_size();
+  std::vector<unsigned> argPerm;
+  argPerm.reserve(specialized_arg_count);
+  for (unsigned from = 0; from < callee->arg_size(); from++) {
+    if (!specScheme[from]) {
+      argPerm.push_back(from);
     }
-    assert(specialized_arg_count == argPerm.size());
-    Instruction* newInst = specializeCallSite(ci, specialized_callee, argPerm);
-    llvm::ReplaceInstWithInst(ci, newInst);
-    modified = true;
   }
-  
-  return modified;
+  assert(specialized_arg_count == argPerm.size());
+  Instruction* newInst = specializeCallSite(ci, specialized_callee, argPerm);
+  llvm::ReplaceInstWithInst(ci, newInst);
+  return true;
 }
 
-/* Intra-module specialization */
-class SpecializerPass : public llvm::ModulePass {
-private:
-  bool optimize;
-    
-public:
-  static char ID;
-
-  SpecializerPass(bool);
-  virtual ~SpecializerPass();
-  virtual void getAnalysisUsage(llvm::AnalysisUsage &AU) const;
-  virtual bool runOnModule(llvm::Module &M);
-  virtual llvm::StringRef getPassName() const {
-    return "Intra-module specializer";
+static unsigned instructionCount(const Function& f) {
+  unsigned count = 0;
+  for (const BasicBlock& bb: f) {
+    count += bb.size();
   }
-};
-  
-bool SpecializerPass::runOnModule(Module &M) {
+  return count;
+}
+
+SpecializeOptions getPartialEvalOptions() {
+  SpecializeOptions options;
+  options.policy = SpecPolicy;
+  options.maxBounded = MaxSpecCopies;
+  options.profitRatio = ProfitRatio;
+  options.optimize = OptSpecialized;
+  options.maxRounds = MaxRounds;
+  options.maxGrowth = MaxGrowth;
+  options.budget = Budget;
+  options.hotPercent = HotPercent;
+  options.merge = Merge;
+  return options;
+}
+
+bool SpecializeIntraComponent(Module &M, CallGraph &cg,
+			      const SpecializeOptions &options,
+			      IntraSpecializeStats *stats) {
+
+  // -- Specializations made so far, also by earlier runs
+  SpecializationTable table(&M);
 
   // -- Create the specialization policy. Bail out if no policy.
   std::unique_ptr<SpecializationPolicy> policy;
-  switch (SpecPolicy) {
+  switch (options.policy) {
      case SpecializationPolicyType::NOSPECIALIZE:
        return false;
      case SpecializationPolicyType::AGGRESSIVE:
@@ -239,19 +312,24 @@ bool SpecializerPass::runOnModule(Module &M) {
      case SpecializationPolicyType::BOUNDED: {
        std::unique_ptr<SpecializationPolicy> subpolicy =
 	 llvm::make_unique<AggressiveSpecPolicy>();
-       policy.reset(new BoundedSpecPolicy(M, std::move(subpolicy), MaxSpecCopies));
+       policy.reset(new BoundedSpecPolicy(M, table, std::move(subpolicy), options.maxBounded));
        break;
      }
     case SpecializationPolicyType::ONLY_ONCE:
-      policy.reset(new OnlyOnceSpecPolicy(M));
+      policy.reset(new OnlyOnceSpecPolicy(M, table));
       break;
     case SpecializationPolicyType::NONREC: {
       std::unique_ptr<SpecializationPolicy> subpolicy =
 	llvm::make_unique<AggressiveSpecPolicy>();
-      CallGraph& cg = getAnalysis<CallGraphWrapperPass>().getCallGraph();      
       policy.reset(new RecursiveGuardSpecPolicy(std::move(subpolicy), cg));
       break;
     }
+    case SpecializationPolicyType::PROFITABLE: {
+      std::unique_ptr<SpecializationPolicy> subpolicy =
+	llvm::make_unique<RecursiveGuardSpecPolicy>(llvm::make_unique<AggressiveSpecPolicy>(), cg);
+      policy.reset(new ProfitableSpecPolicy(std::move(subpolicy), options.profitRatio));
+      break;
+    }
     default:;;
   }
 
@@ -260,39 +338,188 @@ bool SpecializerPass::runOnModule(Module &M) {
     return false;
   }
 
-  // -- Specialize functions defined in M
-  std::vector<Function*> to_add;
-  SpecializationTable table(&M);  
-  bool modified = false;
+  // -- Clean up the new functions and the functions whose call sites
+  //    were rewritten, instead of the whole module.
+  std::unique_ptr<llvm::legacy::FunctionPassManager> optimizer;
+  if (options.optimize) {
+    optimizer.reset(new llvm::legacy::FunctionPassManager(&M));
+    optimizer->add(createSCCPPass());
+    optimizer->add(createInstructionCombiningPass());
+    optimizer->add(createCFGSimplificationPass());
+    optimizer->add(createEarlyCSEPass());
+    optimizer->add(createDeadCodeEliminationPass());
+    optimizer->doInitialization();
+  }
+
+  // -- Specialize functions defined in M, and then the new functions
+  //    until no more are created. The call sites in a new function
+  //    may have become constant when its arguments were.
+  std::vector<Function*> worklist;
+  SmallPtrSet<Function*, 32> scanned;
+  unsigned size = 0;
   for (auto &f: M) {
     if(f.isDeclaration()) continue;
-    modified |= trySpecializeFunction(&f, table, *policy, to_add);
+    worklist.push_back(&f);
+    scanned.insert(&f);
+    size += instructionCount(f);
   }
-  
-  // -- Optimize new function and add it into the module
-  std::unique_ptr<llvm::legacy::FunctionPassManager> optimizer;
-  if (optimize) {
-    optimizer.reset(new llvm::legacy::FunctionPassManager(&M));
-    //PassManagerBuilder builder;
-    //builder.OptLevel = 3;
-    //builder.populateFunctionPassManager(*optimizer);
+  const unsigned initialSize = size;
+
+  // -- the budget of M unless the caller shares one
+  std::unique_ptr<SpecializationBudget> moduleBudget;
+  if (!options.sharedBudget) {
+    moduleBudget.reset(new SpecializationBudget(M, options.budget));
   }
+  SpecializationBudget& budget =
+    options.sharedBudget ? *options.sharedBudget : *moduleBudget;
+  analysis::ProfileCounts profile(M);
+  SmallSetVector<Function*, 32> callers;
+  unsigned rounds = 0, clones = 0, rewritten = 0, overBudget = 0, cold = 0;
+  bool stopped = false;
+  while (!worklist.empty()) {
+    if (options.maxRounds > 0 && rounds >= options.maxRounds) {
+      errs() << "Stopped intra-module specialization after "
+	     << rounds << " rounds\n";
+      stopped = true;
+      break;
+    }
+    if (options.maxGrowth > 0 &&
+	(uint64_t) size * 100 > (uint64_t) initialSize * (100 + options.maxGrowth)) {
+      errs() << "Stopped intra-module specialization because the code grew from "
+	     << initialSize << " to " << size << " instructions\n";
+      stopped = true;
+      break;
+    }
+    ++rounds;
 
-  while (!to_add.empty()) {
-    Function* f = to_add.back();
-    to_add.pop_back();
-    if (f->getParent() == &M  || f->isDeclaration()) {
-      // The function was already in the module or
-      // has already been added in this round of
-      // specialization, no need to add it twice
-      continue;
+    std::vector<IntraCandidate> candidates;
+    for (Function* f: worklist) {
+      cold += collectCandidates(f, *policy, profile, options.hotPercent, candidates);
+    }
+    worklist.clear();
+
+    // -- With a budget, the specializations with the best estimated
+    //    savings per copied instruction go first.
+    std::vector<SpecializationBudget::Candidate> ranking;
+    ranking.reserve(candidates.size());
+    for (unsigned i = 0, e = candidates.size(); i < e; ++i) {
+      if (!budget.isLimited()) {
+	ranking.push_back({0, 0, i});
+	continue;
+      }
+      IntraCandidate& c = candidates[i];
+      Function* callee = CallSite(c.call).getCalledFunction();
+      std::vector<Constant*> args;
+      for (Value* v: c.scheme) {
+	args.push_back(dyn_cast_or_null<Constant>(v));
+      }
+      uint64_t cost = table.lookupSpecialization(callee, c.scheme) ? 0 : instructionCount(*callee);
+      ranking.push_back({cost, 1 + ProfitableSpecPolicy::estimateSavings(*callee, args), i});
+    }
+    SpecializationBudget::rank(ranking);
+
+    std::vector<Function*> to_add;
+    for (const SpecializationBudget::Candidate& r: ranking) {
+      IntraCandidate& c = candidates[r.id];
+      Function* caller = c.call->getParent()->getParent();
+      if (budget.isLimited()) {
+	// the cost drops to zero if an earlier candidate built the copy
+	Function* callee = CallSite(c.call).getCalledFunction();
+	if (!table.lookupSpecialization(callee, c.scheme) &&
+	    !budget.canAfford(instructionCount(*callee))) {
+	  overBudget++;
+	  continue;
+	}
+      }
+      const size_t added = to_add.size();
+      if (specializeCandidate(c, table, to_add)) {
+	rewritten++;
+	callers.insert(caller);
+	if (to_add.size() > added) {
+	  budget.spend(instructionCount(*to_add.back()));
+	}
+      }
+    }
+
+    for (Function* f: to_add) {
+      if (f->isDeclaration() || !scanned.insert(f).second) {
+	// The function has already been added in this round of
+	// specialization, no need to add it twice
+	continue;
+      }
+      if (f->getParent() != &M) {
+	M.getFunctionList().push_back(f);
+      }
+      // Optimized before the next round so that constants propagated
+      // from the arguments reach its call sites
+      if (optimizer) {
+	optimizer->run(*f);
+	profile.invalidate(*f);
+      }
+      worklist.push_back(f);
+      size += instructionCount(*f);
+      clones++;
     }
-    if (optimizer) {
+  }
+
+  if (optimizer) {
+    for (Function* f: callers) {
       optimizer->run(*f);
     }
-    M.getFunctionList().push_back(f);
+    optimizer->doFinalization();
+  }
+
+  // -- Different schemes often give the same code once optimized
+  unsigned merged = 0;
+  if (options.merge) {
+    std::map<std::string, std::string> folded;
+    merged = mergeSpecializations(M, table, folded);
   }
 
+  errs() << "Intra-module specialization: " << rounds << " rounds, "
+	 << clones << " new functions, " << rewritten
+	 << " call sites rewritten in " << callers.size() << " functions, "
+	 << merged << " identical functions merged\n";
+  if (profile.hasProfile()) {
+    errs() << "Intra-module specialization: " << cold << " cold call sites skipped\n";
+  }
+  if (budget.isLimited()) {
+    errs() << "Specialization budget: " << budget.spent() << " of "
+	   << budget.total() << " instructions spent, " << overBudget
+	   << " call sites skipped\n";
+    budget.save();
+  }
+  if (stats) {
+    stats->rounds = rounds;
+    stats->clones = clones;
+    stats->rewritten = rewritten;
+    stats->callers = callers.size();
+    stats->stopped = stopped;
+  }
+  return rewritten > 0 || merged > 0;
+}
+
+/* Intra-module specialization */
+class SpecializerPass : public llvm::ModulePass {
+private:
+  SpecializeOptions options;
+    
+public:
+  static char ID;
+
+  SpecializerPass(const SpecializeOptions&);
+  virtual ~SpecializerPass();
+  virtual void getAnalysisUsage(llvm::AnalysisUsage &AU) const;
+  virtual bool runOnModule(llvm::Module &M);
+  virtual llvm::StringRef getPassName() const {
+    return "Intra-module specializer";
+  }
+};
+  
+bool SpecializerPass::runOnModule(Module &M) {
+  CallGraph& cg = getAnalysis<CallGraphWrapperPass>().getCallGraph();
+  bool modified = SpecializeIntraComponent(M, cg, options);
+
   if (modified) {
     errs() << "...progress...\n";
   } else {
@@ -307,10 +534,10 @@ void SpecializerPass::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.setPreservesAll();
 }
 
-SpecializerPass::SpecializerPass(bool opt)
+SpecializerPass::SpecializerPass(const SpecializeOptions& opts)
   : ModulePass(SpecializerPass::ID)
-  , optimize(opt) {
-  errs() << "SpecializerPass(" << optimize << ")\n";
+  , options(opts) {
+  errs() << "SpecializerPass(" << options.optimize << ")\n";
 }
 
 SpecializerPass::~SpecializerPass() {}
@@ -318,7 +545,7 @@ SpecializerPass::~SpecializerPass() {}
 class ParEvalOptPass : public SpecializerPass {
 public:
   ParEvalOptPass()
-    : SpecializerPass(OptSpecialized.getValue()) {}
+    : SpecializerPass(getPartialEvalOptions()) {}
 };
 
 char SpecializerPass::ID;
@@ -0,0 +1,642 @@
+//
+// OCCAM
+//
+// Copyright (c) 2011-2020, SRI International
+//
+//  All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of SRI International nor the names of its contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "MappedInterface.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "proto/Previrt.pb.h"
+
+using namespace llvm;
+
+static cl::opt<bool>
+MappedOutput("Pmapped-output",
+             cl::init(false),
+             cl::Hidden,
+             cl::desc("Write interface and rewrite files in the mapped binary format"));
+
+namespace previrt
+{
+  static const char Magic[8] = { 'O', 'C', 'C', 'A', 'M', 'I', 'F', 'X' };
+  static const unsigned Version = 1;
+  static const unsigned HeaderSize = 44;
+  static const unsigned ArgWords = 4;
+  static const unsigned NoRewrite = ~0u;
+
+  /* Writer */
+
+  namespace {
+  class MappedWriter {
+    std::string records;
+    std::string strings;
+    // offsets of the interned strings in the string area
+    StringMap<unsigned> offsets;
+
+  public:
+    MappedWriter() : records(HeaderSize, '\0') {}
+
+    unsigned
+    position() const
+    {
+      return records.size();
+    }
+
+    void
+    put(unsigned v)
+    {
+      char buf[4];
+      support::endian::write32le(buf, v);
+      records.append(buf, 4);
+    }
+
+    void
+    patch(unsigned pos, unsigned v)
+    {
+      support::endian::write32le(&records[pos], v);
+    }
+
+    void
+    putString(StringRef s)
+    {
+      StringMap<unsigned>::iterator i = offsets.find(s);
+      unsigned offset;
+      if (i == offsets.end()) {
+        offset = strings.size();
+        strings.append(s.data(), s.size());
+        offsets[s] = offset;
+      } else {
+        offset = i->second;
+      }
+      put(offset);
+      put(s.size());
+    }
+
+    void
+    putArg(const PrevirtType& t)
+    {
+      PrevirtType::Kind kind = t.getKind();
+      put((unsigned) kind | (t.getFlag() ? 0x100 : 0) |
+          (t.getSemanticsCode() << 16));
+      switch (kind) {
+      case PrevirtType::INT:
+      case PrevirtType::FLOAT: {
+        const APInt& v = t.getValue();
+        put(v.getBitWidth());
+        if (v.getBitWidth() <= 64) {
+          uint64_t x = v.getZExtValue();
+          put((unsigned) x);
+          put((unsigned) (x >> 32));
+        } else {
+          unsigned offset = strings.size();
+          for (unsigned w = 0; w < v.getNumWords(); w++) {
+            char buf[8];
+            support::endian::write64le(buf, v.getRawData()[w]);
+            strings.append(buf, 8);
+          }
+          put(offset);
+          put(v.getNumWords());
+        }
+        break;
+      }
+      case PrevirtType::STRING:
+      case PrevirtType::GLOBAL:
+        put(0);
+        putString(t.getName());
+        break;
+      default:
+        put(0);
+        put(0);
+        put(0);
+        break;
+      }
+    }
+
+    void
+    putCall(const CallInfo& call, const CallRewrite* rw)
+    {
+      put(call.count);
+      put(call.args.size());
+      if (rw != NULL) {
+        putString(rw->function);
+        put(rw->args.size());
+      } else {
+        put(NoRewrite);
+        put(0);
+        put(0);
+      }
+      for (std::vector<PrevirtType>::const_iterator a = call.args.begin(),
+          ae = call.args.end(); a != ae; ++a)
+        putArg(*a);
+      if (rw != NULL) {
+        for (std::vector<unsigned>::const_iterator a = rw->args.begin(),
+            ae = rw->args.end(); a != ae; ++a)
+          put(*a);
+      }
+    }
+
+    // Write out everything. transform is null for an interface.
+    bool
+    write(const ComponentInterface& iface,
+        const ComponentInterfaceTransform* transform,
+        const std::string& filename)
+    {
+      std::vector<StringRef> names;
+      for (ComponentInterface::FunctionIterator f = iface.begin(),
+          fe = iface.end(); f != fe; ++f)
+        names.push_back(f->first());
+      std::sort(names.begin(), names.end());
+
+      // the calls of each function that are written
+      std::vector<std::vector<std::pair<const CallInfo*, const CallRewrite*> > >
+          calls(names.size());
+      unsigned numCalls = 0;
+      for (unsigned f = 0; f < names.size(); f++) {
+        for (ComponentInterface::CallIterator c = iface.call_begin(names[f]),
+            ce = iface.call_end(names[f]); c != ce; ++c) {
+          const CallRewrite* rw = NULL;
+          if (transform != NULL) {
+            rw = transform->lookupRewrite(names[f].str(), *c);
+            if (rw == NULL)
+              continue;
+          }
+          calls[f].push_back(std::make_pair(*c, rw));
+        }
+        numCalls += calls[f].size();
+      }
+
+      std::vector<StringRef> refs;
+      if (transform == NULL)
+        refs.assign(iface.references.begin(), iface.references.end());
+
+      unsigned functionsOffset = position();
+      unsigned first = 0;
+      for (unsigned f = 0; f < names.size(); f++) {
+        putString(names[f]);
+        put(first);
+        put(calls[f].size());
+        first += calls[f].size();
+      }
+
+      unsigned referencesOffset = position();
+      for (unsigned r = 0; r < refs.size(); r++)
+        putString(refs[r]);
+
+      unsigned callsOffset = position();
+      for (unsigned c = 0; c < numCalls; c++)
+        put(0);
+
+      unsigned index = 0;
+      for (unsigned f = 0; f < names.size(); f++) {
+        for (unsigned c = 0; c < calls[f].size(); c++, index++) {
+          patch(callsOffset + 4 * index, position());
+          putCall(*calls[f][c].first, calls[f][c].second);
+        }
+      }
+
+      unsigned stringsOffset = position();
+      memcpy(&records[0], Magic, sizeof(Magic));
+      patch(8, Version);
+      patch(12, transform != NULL ? 1 : 0);
+      patch(16, names.size());
+      patch(20, functionsOffset);
+      patch(24, refs.size());
+      patch(28, referencesOffset);
+      patch(32, numCalls);
+      patch(36, callsOffset);
+      patch(40, stringsOffset);
+
+      std::ofstream output(filename.c_str(), std::ios::binary | std::ios::trunc);
+      if (output.fail())
+        return false;
+      output.write(records.data(), records.size());
+      output.write(strings.data(), strings.size());
+      output.close();
+      return !output.fail();
+    }
+  };
+  }
+
+  bool
+  writeMappedInterface(const ComponentInterface& iface,
+      const std::string& filename)
+  {
+    MappedWriter writer;
+    return writer.write(iface, NULL, filename);
+  }
+
+  bool
+  writeMappedTransform(const ComponentInterfaceTransform& transform,
+      const std::string& filename)
+  {
+    MappedWriter writer;
+    return writer.write(transform.getInterface(), &transform, filename);
+  }
+
+  bool
+  writeInterfaceFile(const ComponentInterface& iface,
+      const std::string& filename)
+  {
+    if (MappedOutput)
+      return writeMappedInterface(iface, filename);
+
+    proto::ComponentInterface buf;
+    codeInto<ComponentInterface, proto::ComponentInterface>(iface, buf);
+    std::ofstream output(filename.c_str(), std::ios::binary | std::ios::trunc);
+    bool success = buf.SerializeToOstream(&output);
+    output.close();
+    return success;
+  }
+
+  bool
+  writeTransformFile(const ComponentInterfaceTransform& transform,
+      const std::string& filename)
+  {
+    if (MappedOutput)
+      return writeMappedTransform(transform, filename);
+
+    proto::ComponentInterfaceTransform buf;
+    codeInto(transform, buf);
+    std::ofstream output(filename.c_str(), std::ios::binary | std::ios::trunc);
+    bool success = buf.SerializeToOstream(&output);
+    output.close();
+    return success;
+  }
+
+  /* Reader */
+
+  MappedInterface::MappedInterface(std::unique_ptr<MemoryBuffer> buf)
+    : buffer(std::move(buf))
+  {
+    base = buffer->getBufferStart();
+    size = buffer->getBufferSize();
+    flags = word(12);
+    numFunctions = word(16);
+    functionsOffset = word(20);
+    numReferences = word(24);
+    referencesOffset = word(28);
+    numCalls = word(32);
+    callsOffset = word(36);
+    stringsOffset = word(40);
+  }
+
+  MappedInterface::~MappedInterface()
+  {
+  }
+
+  std::unique_ptr<MappedInterface>
+  MappedInterface::open(const std::string& filename)
+  {
+    ErrorOr<std::unique_ptr<MemoryBuffer> > buf =
+        MemoryBuffer::getFile(filename, -1, false);
+    if (!buf)
+      return nullptr;
+    if ((*buf)->getBufferSize() < HeaderSize ||
+        memcmp((*buf)->getBufferStart(), Magic, sizeof(Magic)) != 0 ||
+        support::endian::read32le((*buf)->getBufferStart() + 8) != Version)
+      return nullptr;
+
+    std::unique_ptr<MappedInterface> result(new MappedInterface(std::move(*buf)));
+    // the tables must fit before the string area
+    uint64_t end = result->stringsOffset;
+    if (end > result->size ||
+        result->functionsOffset + 16ull * result->numFunctions > end ||
+        result->referencesOffset + 8ull * result->numReferences > end ||
+        result->callsOffset + 4ull * result->numCalls > end ||
+        !result->validate()) {
+      errs() << "[MappedInterface] malformed file " << filename << "\n";
+      return nullptr;
+    }
+    return result;
+  }
+
+  bool
+  MappedInterface::validString(size_t offset) const
+  {
+    uint64_t start = (uint64_t) stringsOffset + word(offset);
+    return start + word(offset + 4) <= size;
+  }
+
+  bool
+  MappedInterface::validate() const
+  {
+    // the accessors only assert the ranges that are checked here
+    for (unsigned f = 0; f < numFunctions; f++) {
+      size_t entry = functionsOffset + 16 * f;
+      if (!validString(entry) ||
+          (uint64_t) word(entry + 8) + word(entry + 12) > numCalls)
+        return false;
+    }
+    for (unsigned r = 0; r < numReferences; r++) {
+      if (!validString(referencesOffset + 8 * r))
+        return false;
+    }
+    for (unsigned c = 0; c < numCalls; c++) {
+      uint64_t rec = word(callsOffset + 4 * c);
+      if (rec < HeaderSize || rec + 20 > stringsOffset)
+        return false;
+      unsigned numArgs = word(rec + 4);
+      bool rewritten = word(rec + 8) != NoRewrite;
+      unsigned numRwArgs = word(rec + 16);
+      if (rec + 20 + 4ull * ArgWords * numArgs + 4ull * numRwArgs > stringsOffset)
+        return false;
+      if (rewritten ? !validString(rec + 8) : numRwArgs != 0)
+        return false;
+      for (unsigned i = 0; i < numArgs; i++) {
+        size_t arg = rec + 20 + 4 * ArgWords * i;
+        switch ((PrevirtType::Kind) (word(arg) & 0xff)) {
+        case PrevirtType::INT:
+        case PrevirtType::FLOAT: {
+          unsigned bits = word(arg + 4);
+          if (bits == 0)
+            return false;
+          if (bits > 64) {
+            uint64_t start = (uint64_t) stringsOffset + word(arg + 8);
+            unsigned words = word(arg + 12);
+            if (words != (bits + 63) / 64 || start + 8ull * words > size)
+              return false;
+          }
+          break;
+        }
+        case PrevirtType::STRING:
+        case PrevirtType::GLOBAL:
+          if (!validString(arg + 8))
+            return false;
+          break;
+        default:
+          break;
+        }
+      }
+      // a rewrite keeps some of the arguments of the call
+      size_t rwArgs = rec + 20 + 4 * ArgWords * numArgs;
+      for (unsigned i = 0; i < numRwArgs; i++) {
+        if (word(rwArgs + 4 * i) >= numArgs)
+          return false;
+      }
+    }
+    return true;
+  }
+
+  unsigned
+  MappedInterface::word(size_t offset) const
+  {
+    assert(offset + 4 <= size);
+    return support::endian::read32le(base + offset);
+  }
+
+  StringRef
+  MappedInterface::string(size_t offset) const
+  {
+    size_t start = stringsOffset + word(offset);
+    size_t len = word(offset + 4);
+    assert(start + len <= size);
+    return StringRef(base + start, len);
+  }
+
+  size_t
+  MappedInterface::callRecord(unsigned f, unsigned c) const
+  {
+    assert(f < numFunctions && c < calls(f));
+    unsigned first = word(functionsOffset + 16 * f + 8);
+    return word(callsOffset + 4 * (first + c));
+  }
+
+  bool
+  MappedInterface::isTransform() const
+  {
+    return flags & 1;
+  }
+
+  unsigned
+  MappedInterface::functions() const
+  {
+    return numFunctions;
+  }
+
+  StringRef
+  MappedInterface::functionName(unsigned f) const
+  {
+    assert(f < numFunctions);
+    return string(functionsOffset + 16 * f);
+  }
+
+  int
+  MappedInterface::findFunction(StringRef name) const
+  {
+    unsigned lo = 0, hi = numFunctions;
+    while (lo < hi) {
+      unsigned mid = lo + (hi - lo) / 2;
+      int cmp = functionName(mid).compare(name);
+      if (cmp == 0)
+        return mid;
+      if (cmp < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return -1;
+  }
+
+  unsigned
+  MappedInterface::calls(unsigned f) const
+  {
+    assert(f < numFunctions);
+    return word(functionsOffset + 16 * f + 12);
+  }
+
+  unsigned
+  MappedInterface::callCount(unsigned f, unsigned c) const
+  {
+    return word(callRecord(f, c));
+  }
+
+  unsigned
+  MappedInterface::args(unsigned f, unsigned c) const
+  {
+    return word(callRecord(f, c) + 4);
+  }
+
+  PrevirtType
+  MappedInterface::arg(unsigned f, unsigned c, unsigned i) const
+  {
+    assert(i < args(f, c));
+    size_t rec = callRecord(f, c) + 20 + 4 * ArgWords * i;
+    unsigned tag = word(rec);
+    PrevirtType::Kind kind = (PrevirtType::Kind) (tag & 0xff);
+    bool flag = tag & 0x100;
+    unsigned sem = tag >> 16;
+    switch (kind) {
+    case PrevirtType::INT:
+    case PrevirtType::FLOAT: {
+      unsigned bits = word(rec + 4);
+      if (bits <= 64) {
+        uint64_t v = word(rec + 8) | ((uint64_t) word(rec + 12) << 32);
+        return PrevirtType::get(kind, flag, APInt(bits, v), sem, StringRef());
+      }
+      size_t start = stringsOffset + word(rec + 8);
+      unsigned words = word(rec + 12);
+      assert(start + 8ull * words <= size);
+      std::vector<uint64_t> raw(words);
+      for (unsigned w = 0; w < words; w++)
+        raw[w] = support::endian::read64le(base + start + 8 * w);
+      return PrevirtType::get(kind, flag, APInt(bits, raw), sem, StringRef());
+    }
+    case PrevirtType::STRING:
+    case PrevirtType::GLOBAL:
+      return PrevirtType::get(kind, flag, APInt(), 0, string(rec + 8));
+    default:
+      return PrevirtType::get(kind, flag, APInt(), 0, StringRef());
+    }
+  }
+
+  bool
+  MappedInterface::rewrite(unsigned f, unsigned c, StringRef& function,
+      std::vector<unsigned>& rwArgs) const
+  {
+    size_t rec = callRecord(f, c);
+    if (word(rec + 8) == NoRewrite)
+      return false;
+    function = string(rec + 8);
+    unsigned n = word(rec + 16);
+    size_t start = rec + 20 + 4 * ArgWords * word(rec + 4);
+    rwArgs.clear();
+    for (unsigned i = 0; i < n; i++)
+      rwArgs.push_back(word(start + 4 * i));
+    return true;
+  }
+
+  unsigned
+  MappedInterface::references() const
+  {
+    return numReferences;
+  }
+
+  StringRef
+  MappedInterface::reference(unsigned r) const
+  {
+    assert(r < numReferences);
+    return string(referencesOffset + 8 * r);
+  }
+
+  bool
+  MappedInterface::isReferenced(StringRef name) const
+  {
+    unsigned lo = 0, hi = numReferences;
+    while (lo < hi) {
+      unsigned mid = lo + (hi - lo) / 2;
+      int cmp = reference(mid).compare(name);
+      if (cmp == 0)
+        return true;
+      if (cmp < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return false;
+  }
+
+  void
+  MappedInterface::readCalls(unsigned f, ComponentInterface& out) const
+  {
+    StringRef name = functionName(f);
+    for (unsigned c = 0, ce = calls(f); c < ce; c++) {
+      std::vector<PrevirtType> as;
+      for (unsigned i = 0, ie = args(f, c); i < ie; i++)
+        as.push_back(arg(f, c, i));
+      out.getOrCreateCall(name.str(), as)->count += callCount(f, c);
+    }
+  }
+
+  void
+  MappedInterface::readCalls(unsigned f, ComponentInterfaceTransform& out) const
+  {
+    if (out.interface == NULL) {
+      out.ownsIface = true;
+      out.interface = new ComponentInterface();
+    }
+    StringRef name = functionName(f);
+    for (unsigned c = 0, ce = calls(f); c < ce; c++) {
+      std::vector<PrevirtType> as;
+      for (unsigned i = 0, ie = args(f, c); i < ie; i++)
+        as.push_back(arg(f, c, i));
+      CallInfo* call = out.interface->getOrCreateCall(name.str(), as);
+      call->count += callCount(f, c);
+
+      StringRef function;
+      std::vector<unsigned> rwArgs;
+      if (rewrite(f, c, function, rwArgs))
+        out.rewrite(name.str(), call, function.str(), rwArgs);
+    }
+  }
+
+  bool
+  MappedInterface::readCallsInto(StringRef name, ComponentInterfaceTransform& out) const
+  {
+    int f = findFunction(name);
+    if (f < 0)
+      return false;
+    readCalls(f, out);
+    return true;
+  }
+
+  void
+  MappedInterface::readInto(ComponentInterface& out) const
+  {
+    for (unsigned f = 0; f < numFunctions; f++)
+      readCalls(f, out);
+    for (unsigned r = 0; r < numReferences; r++)
+      out.reference(reference(r));
+  }
+
+  void
+  MappedInterface::readInto(ComponentInterfaceTransform& out) const
+  {
+    for (unsigned f = 0; f < numFunctions; f++)
+      readCalls(f, out);
+    if (out.interface == NULL) {
+      out.ownsIface = true;
+      out.interface = new ComponentInterface();
+    }
+    for (unsigned r = 0; r < numReferences; r++)
+      out.interface->reference(reference(r));
+    out.compile();
+  }
+}
@@ -45,9 +45,11 @@ using namespace llvm;
 
 namespace previrt {
 
-  static StringRef OccamSpecStr = "__occam_spec.";
+  OnlyOnceSpecPolicy::OnlyOnceSpecPolicy(const SpecializationTable &table)
+    : m_table(table) {}
   
-  OnlyOnceSpecPolicy::OnlyOnceSpecPolicy(Module &M) {
+  OnlyOnceSpecPolicy::OnlyOnceSpecPolicy(Module &M, const SpecializationTable &table)
+    : m_table(table) {
     // Precompute some information used by intra specialization
     DenseSet<const Function*> calledS;
     for (auto &F: M) {
@@ -76,7 +78,7 @@ namespace previrt {
       return false;
     }
     // don't touch a function if has been already specialized
-    if (calleeF->getName().startswith(OccamSpecStr)) {
+    if (m_table.isSpecialization(calleeF)) {
       return false;
     }
     auto it = m_blacklist.find(calleeF);
@@ -93,7 +95,7 @@ namespace previrt {
 					     SmallBitVector& marks) {
 
     // don't touch a function if has been already specialized
-    if (calleeF.getName().startswith(OccamSpecStr)) {
+    if (m_table.isSpecialization(&calleeF)) {
       return false;
     }
     
@@ -50,6 +50,7 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/ValueTracking.h"
 
+#include "llvm/ADT/StringSet.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -57,27 +58,74 @@
 #include "proto/Previrt.pb.h"
 #include "Specializer.h"
 
+#include <algorithm>
+#include <mutex>
+
 using namespace llvm;
 
 namespace previrt
 {
-  PrevirtType::EqCache PrevirtType::cacheEq;
+  // Strings and global names are shared by all the types that mention
+  // them, so that copying and comparing them is cheap.
+  static StringRef
+  intern(StringRef str)
+  {
+    static std::mutex lock;
+    static StringSet<> pool;
+    std::lock_guard<std::mutex> guard(lock);
+    return pool.insert(str).first->getKey();
+  }
 
-  PrevirtType::PrevirtType()
+  static const fltSemantics*
+  semanticsFromProto(proto::FloatSemantics sem)
+  {
+    switch (sem) {
+    case proto::IEEEhalf: return &APFloat::IEEEhalf();
+    case proto::IEEEsingle: return &APFloat::IEEEsingle();
+    case proto::IEEEdouble: return &APFloat::IEEEdouble();
+    case proto::IEEEquad: return &APFloat::IEEEquad();
+    case proto::x87DoubleExtended: return &APFloat::x87DoubleExtended();
+    case proto::Bogus: return &APFloat::Bogus();
+    case proto::PPCDoubleDouble: return &APFloat::PPCDoubleDouble();
+    }
+    return NULL;
+  }
+
+  static bool
+  semanticsToProto(const fltSemantics* sem, proto::FloatSemantics& out)
   {
-    buffer.set_type(proto::U);
+    if (sem == &APFloat::Bogus()) {
+      out = proto::Bogus;
+    } else if (sem == &APFloat::IEEEhalf()) {
+      out = proto::IEEEhalf;
+    } else if (sem == &APFloat::IEEEdouble()) {
+      out = proto::IEEEdouble;
+    } else if (sem == &APFloat::IEEEquad()) {
+      out = proto::IEEEquad;
+    } else if (sem == &APFloat::IEEEsingle()) {
+      out = proto::IEEEsingle;
+    } else if (sem == &APFloat::PPCDoubleDouble()) {
+      out = proto::PPCDoubleDouble;
+    } else if (sem == &APFloat::x87DoubleExtended()) {
+      out = proto::x87DoubleExtended;
+    } else {
+      return false;
+    }
+    return true;
   }
 
-  PrevirtType::PrevirtType(const proto::PrevirtType& pt)
+  static std::string
+  floatToHex(const fltSemantics* sem, const APInt& bits)
   {
-    buffer.CopyFrom(pt);
+    char dst[128];
+    APFloat(*sem, bits).convertToHexString(dst, 0, false,
+        APFloat::rmNearestTiesToEven);
+    return dst;
   }
 
-  PrevirtType&
-  PrevirtType::operator=(const PrevirtType& from)
+  PrevirtType::PrevirtType()
+    : kind(UNKNOWN), flag(false), sem(NULL)
   {
-    this->buffer.CopyFrom(from.buffer);
-    return *this;
   }
 
   bool
@@ -86,25 +134,32 @@ namespace previrt
     return !(*this == other);
   }
 
+  PrevirtType
+  PrevirtType::join(const PrevirtType& a, const PrevirtType& b)
+  {
+    if (a == b)
+      return a;
+    return PrevirtType::unknown();
+  }
+
   bool
   PrevirtType::operator==(const PrevirtType& other) const
   {
-    if (buffer.type() != other.buffer.type())
+    if (kind != other.kind)
       return false;
-    switch (buffer.type()) {
-    default:
-      assert(false && "missing case in PrevirtType::operator==");
-    case proto::U:
-    case proto::N:
+    switch (kind) {
+    case UNKNOWN:
+    case NUL:
       return true;
-    case proto::S:
-      return buffer.str().data() == other.buffer.str().data();
-    case proto::I:
-    case proto::F:
-      return buffer.int_().bits() == other.buffer.int_().bits()
-          && buffer.int_().value() == other.buffer.int_().value();
-    case proto::G:
-      return buffer.global().name() == other.buffer.global().name();
+    case STRING:
+    case GLOBAL:
+      // interned
+      return name.data() == other.name.data();
+    case INT:
+      return value.getBitWidth() == other.value.getBitWidth()
+          && value == other.value;
+    case FLOAT:
+      return sem == other.sem && value == other.value;
     }
     return false;
   }
@@ -118,16 +173,13 @@ namespace previrt
   PrevirtType
   PrevirtType::unknown()
   {
-    PrevirtType t;
-    t.buffer.set_type(proto::U);
-    return t;
+    return PrevirtType();
   }
 
   PrevirtType
   PrevirtType::abstract(const llvm::Value* const val)
   {
     PrevirtType result;
-    result.buffer.set_type(proto::U);
     const Constant* cnst = dyn_cast<const Constant>(val);
     if (cnst == NULL) {
 #if DUMP
@@ -200,37 +252,21 @@ namespace previrt
     errs() << "\n";
 #endif
     if (const ConstantInt* ci = dyn_cast<const ConstantInt> (val)) {
-      result.buffer.set_type(proto::I);
-      result.buffer.mutable_int_()->set_bits(ci->getBitWidth());
-      result.buffer.mutable_int_()->set_value(
-          ci->getValue().toString(16, true));
+      result.kind = INT;
+      result.value = ci->getValue();
       return result;
     } else if (cnst->isNullValue()) {
-      result.buffer.set_type(proto::N);
+      result.kind = NUL;
       return result;
     } else if (const ConstantFP* cf = dyn_cast<const ConstantFP>(val)) {
-      char dst[128];
       const APFloat& val = cf->getValueAPF();
-      val.convertToHexString(dst, 0, false, APFloat::rmNearestTiesToEven);
-      if (&val.getSemantics() == &APFloat::Bogus()) {
-        result.buffer.mutable_float_()->set_sem(proto::Bogus);
-      } else if (&val.getSemantics() == &APFloat::IEEEhalf()) {
-        result.buffer.mutable_float_()->set_sem(proto::IEEEhalf);
-      } else if (&val.getSemantics() == &APFloat::IEEEdouble()) {
-        result.buffer.mutable_float_()->set_sem(proto::IEEEdouble);
-      } else if (&val.getSemantics() == &APFloat::IEEEquad()) {
-        result.buffer.mutable_float_()->set_sem(proto::IEEEquad);
-      } else if (&val.getSemantics() == &APFloat::IEEEsingle()) {
-        result.buffer.mutable_float_()->set_sem(proto::IEEEsingle);
-      } else if (&val.getSemantics() == &APFloat::PPCDoubleDouble()) {
-        result.buffer.mutable_float_()->set_sem(proto::PPCDoubleDouble);
-      } else if (&val.getSemantics() == &APFloat::x87DoubleExtended()) {
-        result.buffer.mutable_float_()->set_sem(proto::x87DoubleExtended);
-      } else {
+      proto::FloatSemantics sem;
+      if (!semanticsToProto(&val.getSemantics(), sem)) {
         return result;
       }
-      result.buffer.mutable_float_()->set_data(dst);
-      result.buffer.set_type(proto::F);
+      result.kind = FLOAT;
+      result.sem = &val.getSemantics();
+      result.value = val.bitcastToAPInt();
       return result;
     } else if (const GlobalValue* gv = dyn_cast<const GlobalValue>(cnst)) {
       // gv can be alias, function or variable
@@ -238,18 +274,18 @@ namespace previrt
 
       // function
       if (isa<Function>(gv) && gv->getName() != "") {
-	result.buffer.set_type(proto::G);
-	result.buffer.mutable_global()->set_name(gv->getName().data());
+	result.kind = GLOBAL;
+	result.name = intern(gv->getName());
 	return result;
       }
 
       // global alias or variable
       if (gv->getName() != "") {
         if (gv->isExternalLinkage(gv->getLinkage())) {
-          result.buffer.set_type(proto::G);
-          result.buffer.mutable_global()->set_name(gv->getName().data());
+          result.kind = GLOBAL;
+          result.name = intern(gv->getName());
           if (const GlobalVariable* gvar = dyn_cast<GlobalVariable>(gv)) {
-            result.buffer.mutable_global()->set_is_const(gvar->isConstant());
+            result.flag = gvar->isConstant();
           }
           return result;
         } else {
@@ -260,8 +296,9 @@ namespace previrt
 	StringRef out;
 	// See if it's a string constant
 	if (StringFromValue(val, out)) {
-	  result.buffer.set_type(proto::S);
-	  result.buffer.mutable_str()->set_data(out);
+	  result.kind = STRING;
+	  result.flag = true;
+	  result.name = intern(out);
 	  return result;
 	}
     }
@@ -275,63 +312,48 @@ namespace previrt
     const Constant* cnst = dyn_cast<const Constant>(val);
     // TODO: Why did I start needing this?
     if (cnst == NULL) {
-      if (this->buffer.type() == proto::U)
+      if (kind == UNKNOWN)
         return LOOSE_MATCH;
       else
         return NO_MATCH;
     }
-    switch (buffer.type()) {
-    default:
-      assert(false);
-      break;
-    case proto::U:
+    switch (kind) {
+    case UNKNOWN:
       return LOOSE_MATCH;
-    case proto::N: {
+    case NUL: {
       if (cnst->isNullValue())
         return EXACT_MATCH;
       else
         return NO_MATCH;
     }
-    case proto::S: {
+    case STRING: {
       StringRef out;
       if (StringFromValue(val, out)) {
-        if (out == buffer.str().data())
+        if (out == name)
           return EXACT_MATCH;
         else
           return NO_MATCH;
       }
       return NO_MATCH;
     }
-    case proto::I:
+    case INT:
       if (const ConstantInt* va = dyn_cast<const ConstantInt>(val)) {
-        if (buffer.int_().bits() == va->getBitWidth()
-            && buffer.int_().value() == va->getValue().toString(16, true))
+        if (value.getBitWidth() == va->getBitWidth()
+            && value == va->getValue())
           return EXACT_MATCH;
       }
       return NO_MATCH;
-    case proto::F:
+    case FLOAT:
       if (const ConstantFP* va = dyn_cast<const ConstantFP>(val)) {
-        const fltSemantics* sem = NULL;
-        switch (buffer.float_().sem()) {
-#define CASE(x) case proto::x: { if (&va->getValueAPF().getSemantics() != &APFloat::x()) return NO_MATCH; sem = &APFloat::x(); break; }
-        CASE(IEEEdouble)
-        CASE(IEEEhalf)
-        CASE(IEEEsingle)
-        CASE(IEEEquad)
-        CASE(x87DoubleExtended)
-        CASE(PPCDoubleDouble)
-        CASE(Bogus)
-#undef CASE
-        }
-        APFloat apf(*sem, buffer.float_().data());
-        if (apf.bitwiseIsEqual(va->getValueAPF())) {
+        if (&va->getValueAPF().getSemantics() == sem
+            && va->getValueAPF().bitcastToAPInt() == value) {
           return EXACT_MATCH;
         }
       }
       return NO_MATCH;
-    case proto::G:
+    case GLOBAL:
       if (const GlobalValue* gv = dyn_cast<const GlobalValue>(val->stripPointerCasts())) {
-        if (gv->getName() == buffer.global().name()) {
+        if (gv->getName() == name) {
           return EXACT_MATCH;
         }
       }
@@ -345,35 +367,29 @@ namespace previrt
   PrevirtType::concretize(Module& M, Type* type) const
   {
       llvm::Value *concreteValue = NULL;
-      switch (buffer.type()) {
+      switch (kind) {
       default:
 	  break;
-      case proto::N:
+      case NUL:
 	  concreteValue = Constant::getNullValue(type);
 	  break;
-      case proto::I:
-	  assert(buffer.int_().IsInitialized());
-	  concreteValue =
-	      ConstantInt::get(M.getContext(),
-			       APInt(buffer.int_().bits(), buffer.int_().value(), 16));
+      case INT:
+	  concreteValue = ConstantInt::get(M.getContext(), value);
 	  break;
-      case proto::F:
-	  concreteValue =
-	      ConstantFP::get(type, StringRef(buffer.float_().data()));
+      case FLOAT:
+	  concreteValue = ConstantFP::get(M.getContext(), APFloat(*sem, value));
 	  break;
-      case proto::S:
-	  assert(buffer.str().IsInitialized());
-	  if (!buffer.str().cstr())
+      case STRING:
+	  if (!flag)
 	      break;
 	  { // Scope sc locally
 	      GlobalVariable* sc =
-		  materializeStringLiteral(M, buffer.str().data().c_str());
+		  materializeStringLiteral(M, name.str().c_str());
 	      concreteValue = charStarFromStringConstant(M, sc);
 	  }
 	  break;
-      case proto::G:
-	  assert(buffer.global().IsInitialized());
-	  concreteValue = M.getGlobalVariable(buffer.global().name(), false);
+      case GLOBAL:
+	  concreteValue = M.getGlobalVariable(name, false);
 	  if (concreteValue == NULL) {
 	      // GlobalValues are always pointers and the resulting type
 	      // will be a pointer to the type in the constructor, so we
@@ -386,14 +402,14 @@ namespace previrt
 		     && "Unexpected concretization of G to non-pointer type");
 	      Type * elemType = type->getContainedType(0);
 	      if (elemType->isFunctionTy()) {
-		  concreteValue = M.getFunction(buffer.global().name());
+		  concreteValue = M.getFunction(name);
 		  if (concreteValue == NULL) {
 		      concreteValue = Function::Create(cast<FunctionType>(elemType),
-						       GlobalVariable::ExternalLinkage, buffer.global().name(), &M);
+						       GlobalVariable::ExternalLinkage, name, &M);
 		  }
 	      } else {
-		  concreteValue = new GlobalVariable(M, elemType, buffer.global().is_const(),
-						     GlobalVariable::ExternalLinkage, NULL, buffer.global().name());
+		  concreteValue = new GlobalVariable(M, elemType, flag,
+						     GlobalVariable::ExternalLinkage, NULL, name);
 	      }
 	  }
 	  break;
@@ -408,46 +424,185 @@ namespace previrt
   {
     // TODO: check which of these work
 
-    return buffer.type() == proto::I || // Integer
-      buffer.type() == proto::G || // Global
-      buffer.type() == proto::N || // Null
-      buffer.type() == proto::S || // String
-      buffer.type() == proto::F;  // float
+    return kind == INT || // Integer
+      kind == GLOBAL || // Global
+      kind == NUL || // Null
+      kind == STRING || // String
+      kind == FLOAT;  // float
   }
 
   bool
   PrevirtType::isUnknown() const
   {
-    return buffer.type() == proto::U;
+    return kind == UNKNOWN;
   }
 
   std::string
   PrevirtType::to_string() const
   {
-    switch (buffer.type()) {
+    switch (kind) {
     default:
       return "?";
-    case proto::N:
+    case NUL:
       return "null";
-    case proto::I:
-      assert(buffer.int_().IsInitialized());
-      return std::string("0x") + buffer.int_().value();
-    case proto::F:
-      return buffer.float_().data();
-    case proto::S: {
-      assert(buffer.str().IsInitialized());
-      if (!buffer.str().cstr())
-        return NULL;
-      return std::string("S:") + utohexstr(HashString(buffer.str().data()));
+    case INT:
+      return std::string("0x") + value.toString(16, true);
+    case FLOAT:
+      return floatToHex(sem, value);
+    case STRING: {
+      if (!flag)
+        return "?";
+      return std::string("S:") + utohexstr(HashString(name));
     }
-    case proto::G:
-      assert(buffer.global().IsInitialized());
-      return buffer.global().name();
+    case GLOBAL:
+      return name.str();
     }
 
     return "?";
   }
 
+  static void
+  encodeBytes(std::string& out, StringRef bytes)
+  {
+    out += utostr(bytes.size());
+    out.push_back(':');
+    out += bytes;
+  }
+
+  void
+  PrevirtType::encode(std::string& out) const
+  {
+    out.push_back((char) kind);
+    switch (kind) {
+    default:
+      break;
+    case INT:
+    case FLOAT:
+      out += utostr(value.getBitWidth());
+      out.push_back(':');
+      if (kind == FLOAT) {
+        proto::FloatSemantics s = proto::Bogus;
+        semanticsToProto(sem, s);
+        out += utostr(s);
+        out.push_back(':');
+      }
+      encodeBytes(out, value.getBitWidth() <= 64 ?
+          utohexstr(value.getZExtValue()) : value.toString(16, false));
+      break;
+    case STRING:
+    case GLOBAL:
+      encodeBytes(out, name);
+      break;
+    }
+  }
+
+  void
+  PrevirtType::encodeMatches(const llvm::Value* const val,
+      std::vector<std::string>& out)
+  {
+    assert(val != NULL);
+    const Constant* cnst = dyn_cast<const Constant>(val);
+    if (cnst == NULL)
+      return;
+
+    std::vector<PrevirtType> types;
+    PrevirtType t = abstract(val);
+    if (!t.isUnknown())
+      types.push_back(t);
+    if (cnst->isNullValue()) {
+      PrevirtType n;
+      n.kind = NUL;
+      types.push_back(n);
+    }
+    StringRef str;
+    if (StringFromValue(val, str)) {
+      PrevirtType s;
+      s.kind = STRING;
+      s.name = intern(str);
+      types.push_back(s);
+    }
+    if (const GlobalValue* gv = dyn_cast<const GlobalValue>(val->stripPointerCasts())) {
+      if (gv->getName() != "") {
+        PrevirtType g;
+        g.kind = GLOBAL;
+        g.name = intern(gv->getName());
+        types.push_back(g);
+      }
+    }
+
+    for (unsigned i = 0; i < types.size(); i++) {
+      std::string key;
+      types[i].encode(key);
+      if (std::find(out.begin(), out.end(), key) == out.end())
+        out.push_back(key);
+    }
+  }
+
+  PrevirtType::Kind
+  PrevirtType::getKind() const
+  {
+    return kind;
+  }
+
+  bool
+  PrevirtType::getFlag() const
+  {
+    return flag;
+  }
+
+  const APInt&
+  PrevirtType::getValue() const
+  {
+    return value;
+  }
+
+  unsigned
+  PrevirtType::getSemanticsCode() const
+  {
+    proto::FloatSemantics code;
+    if (kind == FLOAT && semanticsToProto(sem, code))
+      return code;
+    return 0;
+  }
+
+  StringRef
+  PrevirtType::getName() const
+  {
+    return name;
+  }
+
+  PrevirtType
+  PrevirtType::get(Kind kind, bool flag, const APInt& value, unsigned sem,
+      StringRef name)
+  {
+    PrevirtType result;
+    switch (kind) {
+    case UNKNOWN:
+      break;
+    case NUL:
+      result.kind = NUL;
+      break;
+    case INT:
+      result.kind = INT;
+      result.value = value;
+      break;
+    case FLOAT:
+      if (!proto::FloatSemantics_IsValid(sem))
+        break;
+      result.kind = FLOAT;
+      result.sem = semanticsFromProto((proto::FloatSemantics) sem);
+      result.value = value;
+      break;
+    case STRING:
+    case GLOBAL:
+      result.kind = kind;
+      result.flag = flag;
+      result.name = intern(name);
+      break;
+    }
+    return result;
+  }
+
 #if 0
   static Function*
   buildNullEquality(Type* typ, LLVMContext& ctx)
@@ -483,14 +638,15 @@ namespace previrt
 #endif
 
   static Function*
-  buildIntEquality(IntegerType* typ, LLVMContext& ctx)
+  buildIntEquality(IntegerType* typ, Module& M, StringRef name)
   {
+    LLVMContext& ctx = M.getContext();
     Type* ft[2] =
       { typ, typ };
     FunctionType* ftyp = FunctionType::get(Type::getInt1Ty(ctx),
         ArrayRef<Type*>(ft), false);
     Function* f = Function::Create(ftyp, GlobalValue::LinkOnceODRLinkage,
-        "int_eq");
+        name, &M);
     BasicBlock* bb = BasicBlock::Create(ctx, Twine("entry"), f);
     IRBuilder<> builder(bb);
 
@@ -506,14 +662,14 @@ namespace previrt
   }
 
   static Function*
-  buildStringEquality(PointerType* typ, Module& M)
+  buildStringEquality(PointerType* typ, Module& M, StringRef name)
   {
     Type* ft[2] =
       { typ, typ };
     FunctionType* ftyp = FunctionType::get(Type::getInt1Ty(M.getContext()),
         ArrayRef<Type*>(ft), false);
     Function* f = Function::Create(ftyp, GlobalValue::LinkOnceODRLinkage,
-        "int_eq");
+        name, &M);
     BasicBlock* bb = BasicBlock::Create(M.getContext(), Twine("entry"), f);
     IRBuilder<> builder(bb);
 
@@ -537,37 +693,27 @@ namespace previrt
   Function*
   PrevirtType::getEqualityFunction(Module* M) const
   {
-    switch (buffer.type()) {
+    switch (kind) {
     default:
       return NULL;
-    case proto::N: {
+    case NUL: {
       return NULL;
     }
-    case proto::I: {
-      assert(buffer.int_().IsInitialized());
-      IntegerType* typ = Type::getIntNTy(M->getContext(), buffer.int_().bits());
-      EqCache::iterator i = PrevirtType::cacheEq.find(typ);
-      if (i != PrevirtType::cacheEq.end()) {
-        return i->second;
+    case INT: {
+      std::string fname = "previrt.int_eq.i" + utostr(value.getBitWidth());
+      if (Function* f = M->getFunction(fname)) {
+        return f;
       }
-      Function* f = buildIntEquality(typ, M->getContext());
-
-      PrevirtType::cacheEq.insert(std::make_pair(typ, f));
-      M->getFunctionList().push_back(f);
-      return f;
+      IntegerType* typ = Type::getIntNTy(M->getContext(), value.getBitWidth());
+      return buildIntEquality(typ, *M, fname);
     }
-    case proto::S: {
-      assert(buffer.str().IsInitialized());
-      PointerType* typ = Type::getInt8PtrTy(M->getContext());
-      EqCache::iterator i = PrevirtType::cacheEq.find(typ);
-      if (i != PrevirtType::cacheEq.end()) {
-        return i->second;
+    case STRING: {
+      StringRef fname = "previrt.str_eq";
+      if (Function* f = M->getFunction(fname)) {
+        return f;
       }
-      Function* f = buildStringEquality(typ, *M);
-
-      PrevirtType::cacheEq.insert(std::make_pair(typ, f));
-      M->getFunctionList().push_back(f);
-      return f;
+      PointerType* typ = Type::getInt8PtrTy(M->getContext());
+      return buildStringEquality(typ, *M, fname);
     }
     }
 
@@ -580,7 +726,45 @@ namespace previrt
         const previrt::proto::PrevirtType& buf, PrevirtType& result)
     {
       assert(buf.IsInitialized());
-      result.buffer.CopyFrom(buf);
+      result = PrevirtType();
+      switch (buf.type()) {
+      default:
+        break;
+      case proto::N:
+        result.kind = PrevirtType::NUL;
+        break;
+      case proto::I:
+        result.kind = PrevirtType::INT;
+        if (buf.int_().has_value()) {
+          result.value = APInt(buf.int_().bits(), buf.int_().value(), 16);
+        } else {
+          result.value = APInt(buf.int_().bits(), 0);
+        }
+        break;
+      case proto::F: {
+        const fltSemantics* sem = semanticsFromProto(buf.float_().sem());
+        if (sem == NULL)
+          break;
+        result.kind = PrevirtType::FLOAT;
+        result.sem = sem;
+        if (buf.float_().has_data()) {
+          result.value = APFloat(*sem, buf.float_().data()).bitcastToAPInt();
+        } else {
+          result.value = APFloat::getZero(*sem).bitcastToAPInt();
+        }
+        break;
+      }
+      case proto::S:
+        result.kind = PrevirtType::STRING;
+        result.flag = buf.str().cstr();
+        result.name = intern(buf.str().data());
+        break;
+      case proto::G:
+        result.kind = PrevirtType::GLOBAL;
+        result.flag = buf.global().is_const();
+        result.name = intern(buf.global().name());
+        break;
+      }
     }
 
   template<>
@@ -588,7 +772,38 @@ namespace previrt
     codeInto<PrevirtType, proto::PrevirtType>(const PrevirtType& typ,
         proto::PrevirtType& buf)
     {
-      assert(typ.buffer.IsInitialized());
-      buf.CopyFrom(typ.buffer);
+      switch (typ.kind) {
+      case PrevirtType::UNKNOWN:
+        buf.set_type(proto::U);
+        break;
+      case PrevirtType::NUL:
+        buf.set_type(proto::N);
+        break;
+      case PrevirtType::INT:
+        buf.set_type(proto::I);
+        buf.mutable_int_()->set_bits(typ.value.getBitWidth());
+        buf.mutable_int_()->set_value(typ.value.toString(16, true));
+        break;
+      case PrevirtType::FLOAT: {
+        proto::FloatSemantics sem = proto::Bogus;
+        semanticsToProto(typ.sem, sem);
+        buf.set_type(proto::F);
+        buf.mutable_float_()->set_sem(sem);
+        buf.mutable_float_()->set_data(floatToHex(typ.sem, typ.value));
+        break;
+      }
+      case PrevirtType::STRING:
+        buf.set_type(proto::S);
+        buf.mutable_str()->set_data(typ.name.str());
+        if (!typ.flag)
+          buf.mutable_str()->set_cstr(false);
+        break;
+      case PrevirtType::GLOBAL:
+        buf.set_type(proto::G);
+        buf.mutable_global()->set_name(typ.name.str());
+        if (typ.flag)
+          buf.mutable_global()->set_is_const(true);
+        break;
+      }
     }
 }
@@ -40,10 +40,13 @@
 #include "llvm/ADT/StringMap.h"
 
 #include "PrevirtualizeInterfaces.h"
+#include "MappedInterface.h"
 
 #include <vector>
 #include <string>
 #include <fstream>
+#include <memory>
+#include <algorithm>
 
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -94,6 +97,7 @@ namespace previrt
     codeInto<proto::CallInfo, CallInfo> (const proto::CallInfo& buf,
         CallInfo& ci)
     {
+      ci.count = buf.count();
       ci.args.clear();
       ci.args.reserve(buf.args_size());
       for (int i = 0; i < buf.args_size(); i++) {
@@ -150,60 +154,119 @@ namespace previrt
     }
   }
 
+  static std::string
+  encodeArgs(const std::vector<PrevirtType>& args)
+  {
+    std::string key;
+    for (std::vector<PrevirtType>::const_iterator i = args.begin(),
+        e = args.end(); i != e; ++i)
+      i->encode(key);
+    return key;
+  }
+
+  // Calls with more known arguments than this are matched against the
+  // recorded calls one by one instead of through the index.
+  static const unsigned MaxIndexedKnownArgs = 8;
+
+  CallInfo*
+  ComponentInterface::lookup(StringRef f, const std::string& key) const
+  {
+    StringMap<StringMap<unsigned> >::const_iterator fi = index.find(f);
+    if (fi == index.end())
+      return NULL;
+    StringMap<unsigned>::const_iterator ki = fi->second.find(key);
+    if (ki == fi->second.end())
+      return NULL;
+    return calls.find(f)->second[ki->second];
+  }
+
+  // Return the first recorded call of f whose arguments are either
+  // unknown or equal to the corresponding ones in args.
+  CallInfo*
+  ComponentInterface::lookupCovering(StringRef f,
+      const std::vector<PrevirtType>& args) const
+  {
+    FunctionIterator fi = calls.find(f);
+    if (fi == calls.end())
+      return NULL;
+    const std::vector<CallInfo*>& infos = fi->second;
+
+    std::vector<unsigned> known;
+    for (unsigned i = 0; i < args.size(); i++) {
+      if (!args[i].isUnknown())
+        known.push_back(i);
+    }
+
+    if (known.size() > MaxIndexedKnownArgs) {
+      for (CallIterator c = infos.begin(), ce = infos.end(); c != ce; ++c) {
+        if ((*c)->args.size() != args.size())
+          continue;
+        unsigned i = 0;
+        for (; i < args.size(); i++) {
+          if (!(*c)->args[i].isUnknown() && (*c)->args[i] != args[i])
+            break;
+        }
+        if (i == args.size())
+          return *c;
+      }
+      return NULL;
+    }
+
+    // Look up every generalization of args obtained by forgetting some
+    // of its known arguments, and keep the one recorded first.
+    const StringMap<unsigned>& keys = index.find(f)->second;
+    std::vector<PrevirtType> pattern(args);
+    unsigned best = infos.size();
+    for (unsigned mask = 0; mask < (1u << known.size()); mask++) {
+      for (unsigned i = 0; i < known.size(); i++) {
+        pattern[known[i]] =
+            (mask & (1u << i)) ? PrevirtType::unknown() : args[known[i]];
+      }
+      StringMap<unsigned>::const_iterator ki = keys.find(encodeArgs(pattern));
+      if (ki != keys.end() && ki->second < best)
+        best = ki->second;
+    }
+    return best < infos.size() ? infos[best] : NULL;
+  }
+
+  void
+  ComponentInterface::insert(StringRef f, const std::string& key,
+      CallInfo* info)
+  {
+    std::vector<CallInfo*>& infos = calls[f];
+    // keep the first of several calls with the same arguments
+    index[f].insert(std::make_pair(key, infos.size()));
+    infos.push_back(info);
+  }
+
   void
   ComponentInterface::call(FunctionHandle f, User::op_iterator args_begin,
       User::op_iterator args_end)
   {
-    if (this->calls.find(f) == this->calls.end()) {
-      std::vector<CallInfo*> calls;
-      calls.push_back(CallInfo::Create(args_begin, args_end, 1));
-      this->calls[f] = calls;
-    } else {
-      std::vector<CallInfo*>& calls = this->calls[f];
-      for (std::vector<CallInfo*>::const_iterator begin = calls.begin(), end =
-          calls.end(); begin != end; ++begin) {
-        User::op_iterator cur = args_begin;
-        for (std::vector<PrevirtType>::const_iterator i =
-            (*begin)->args.begin(), e = (*begin)->args.end(); i != e; ++i) {
-          if (i->refines(cur->get()) == NO_MATCH)
-            goto no;
-        }
-        (*begin)->count++;
-        return;
-        no: continue;
-      }
+    std::vector<PrevirtType> args;
+    for (; args_begin != args_end; ++args_begin)
+      args.push_back(PrevirtType::abstract(*args_begin));
 
-      this->calls[f].push_back(CallInfo::Create(args_begin, args_end, 1));
+    CallInfo* info = lookupCovering(f, args);
+    if (info != NULL) {
+      info->count++;
+      return;
     }
+    insert(f, encodeArgs(args), CallInfo::Create(args, 1));
   }
 
   void
   ComponentInterface::callAny(const Function* f)
   {
     FunctionHandle fname = f->getName();
-    if (this->calls.find(fname) == this->calls.end()) {
-      std::vector<CallInfo*> calls;
-      CallInfo* ci = CallInfo::Create(f->arg_size(), 1);
-      ci->args.resize(f->arg_size(), PrevirtType::unknown());
-      calls.push_back(ci);
-      this->calls[fname] = calls;
-    } else {
-      std::vector<CallInfo*>& calls = this->calls[fname];
-      for (std::vector<CallInfo*>::const_iterator begin = calls.begin(), end =
-          calls.end(); begin != end; ++begin) {
-        for (std::vector<PrevirtType>::const_iterator i =
-            (*begin)->args.begin(), e = (*begin)->args.end(); i != e; ++i) {
-          if (!i->isUnknown())
-            goto no;
-        }
-        (*begin)->count++;
-        return;
-        no: continue;
-      }
-      CallInfo* ci = CallInfo::Create(f->arg_size(), 1);
-      ci->args.resize(f->arg_size(), PrevirtType::unknown());
-      this->calls[fname].push_back(ci);
+    std::vector<PrevirtType> args(f->arg_size(), PrevirtType::unknown());
+    std::string key = encodeArgs(args);
+    CallInfo* info = lookup(fname, key);
+    if (info != NULL) {
+      info->count++;
+      return;
     }
+    insert(fname, key, CallInfo::Create(args, 1));
   }
 
   void
@@ -216,32 +279,101 @@ namespace previrt
   ComponentInterface::getOrCreateCall(FunctionHandle f, const std::vector<
       PrevirtType>& args)
   {
-    FunctionIterator itr = calls.find(f);
-    CallInfo* result;
-    if (itr == calls.end()) {
-      std::vector<CallInfo*> infos;
+    std::string key = encodeArgs(args);
+    CallInfo* result = lookup(f, key);
+    if (result == NULL) {
       result = CallInfo::Create(args, 0);
-      infos.push_back(result);
-      calls[f] = infos;
-      return result;
-    } else {
-      for (CallIterator c = itr->second.begin(), e = itr->second.end(); c != e; ++c) {
-        if (args.size() != (*c)->args.size())
+      insert(f, key, result);
+    }
+    return result;
+  }
+
+  bool
+  ComponentInterface::join(const ComponentInterface& other)
+  {
+    bool result = false;
+    for (FunctionIterator f = other.begin(), fe = other.end(); f != fe; ++f) {
+      for (CallIterator c = other.call_begin(f), ce = other.call_end(f);
+          c != ce; ++c) {
+        std::string key = encodeArgs((*c)->args);
+        CallInfo* info = lookup(f->first(), key);
+        if (info != NULL) {
+          info->count += (*c)->count;
+        } else {
+          insert(f->first(), key, CallInfo::Create((*c)->args, (*c)->count));
+          result = true;
+        }
+      }
+    }
+    for (std::set<std::string>::const_iterator i = other.references.begin(),
+        e = other.references.end(); i != e; ++i) {
+      result |= this->references.insert(*i).second;
+    }
+    return result;
+  }
+
+  static bool
+  moreFrequent(const CallInfo* a, const CallInfo* b)
+  {
+    return a->count > b->count;
+  }
+
+  unsigned
+  ComponentInterface::compact(unsigned limit)
+  {
+    assert(limit > 0);
+    unsigned folded = 0;
+    for (StringMap<std::vector<CallInfo*> >::iterator f = calls.begin(),
+        fe = calls.end(); f != fe; ++f) {
+      std::vector<CallInfo*>& infos = f->second;
+      if (infos.size() <= limit)
+        continue;
+
+      std::vector<CallInfo*> byCount(infos);
+      std::stable_sort(byCount.begin(), byCount.end(), moreFrequent);
+      std::set<CallInfo*> kept(byCount.begin(), byCount.begin() + (limit - 1));
+
+      // join the arguments of the other calls, by arity
+      std::map<unsigned, CallInfo*> joined;
+      std::vector<CallInfo*> result;
+      for (std::vector<CallInfo*>::iterator c = infos.begin(),
+          ce = infos.end(); c != ce; ++c) {
+        if (kept.count(*c)) {
+          result.push_back(*c);
           continue;
-        std::vector<PrevirtType>::const_iterator x = args.begin();
-        for (std::vector<PrevirtType>::const_iterator y = (*c)->args.begin(),
-            z = args.end(); x != z; ++x, ++y) {
-          if (*x != *y)
-            break;
         }
-        if (x == args.end()) {
-          return *c;
+        CallInfo*& j = joined[(*c)->args.size()];
+        if (j == NULL) {
+          j = CallInfo::Create((*c)->args, 0);
+        } else {
+          for (unsigned i = 0; i < j->args.size(); i++)
+            j->args[i] = PrevirtType::join(j->args[i], (*c)->args[i]);
         }
+        j->count += (*c)->count;
+        delete *c;
+        folded++;
       }
-      result = CallInfo::Create(args, 0);
-      calls[f].push_back(result);
-      return result;
+
+      StringMap<unsigned>& keys = index[f->first()];
+      keys.clear();
+      for (unsigned i = 0; i < result.size(); i++)
+        keys.insert(std::make_pair(encodeArgs(result[i]->args), i));
+      for (std::map<unsigned, CallInfo*>::iterator j = joined.begin(),
+          je = joined.end(); j != je; ++j) {
+        std::string key = encodeArgs(j->second->args);
+        StringMap<unsigned>::iterator k = keys.find(key);
+        if (k != keys.end()) {
+          // the join is already one of the kept calls
+          result[k->second]->count += j->second->count;
+          delete j->second;
+        } else {
+          keys.insert(std::make_pair(key, result.size()));
+          result.push_back(j->second);
+        }
+      }
+      infos.swap(result);
     }
+    return folded;
   }
 
   void
@@ -334,15 +466,7 @@ namespace previrt
         StringRef name = info.name();
         CallInfo* res = new CallInfo();
         codeInto(info, *res);
-        llvm::StringMap<std::vector<CallInfo*> >::iterator itr = ci.calls.find(
-            name);
-        if (itr == ci.calls.end()) {
-          std::vector<CallInfo*> infos;
-          infos.push_back(res);
-          ci.calls[name] = infos;
-        } else {
-          itr->second.push_back(res);
-        }
+        ci.insert(name, encodeArgs(res->args), res);
       }
       for (google::protobuf::RepeatedPtrField<std::string>::const_iterator
           i = buf.references().begin(), e = buf.references().end(); i != e; ++i) {
@@ -354,6 +478,12 @@ namespace previrt
   ComponentInterface::readFromFile(const std::string& filename)
   {
     assert(filename != "");
+    if (std::unique_ptr<MappedInterface> mapped = MappedInterface::open(filename)) {
+      if (mapped->isTransform())
+        return false;
+      mapped->readInto(*this);
+      return true;
+    }
     std::ifstream input(filename.c_str(), std::ios::binary);
     if (input.fail()) {
       return false;
@@ -403,6 +533,108 @@ namespace previrt
       }
     }
 
+  // RewriteMatcher
+
+  // Decision trie over the arguments of the calls to a function. The
+  // edges of a node are labeled by the encoding of a concrete argument,
+  // or are the wildcard edge of an unknown argument. A call sits at the
+  // node reached by following its arguments.
+  class RewriteMatcher {
+    struct Node {
+      StringMap<unsigned> exact;
+      int wildcard;
+      std::vector<unsigned> calls;
+      Node() : wildcard(-1) {}
+    };
+
+    std::vector<Node> nodes;
+    // number of calls compiled into the trie
+    unsigned size;
+
+    void
+    match(unsigned n, const std::vector<std::vector<std::string> >& keys,
+        unsigned arg, int score,
+        std::vector<std::pair<int, unsigned> >& out) const
+    {
+      const Node& node = nodes[n];
+      if (arg == keys.size()) {
+        for (std::vector<unsigned>::const_iterator i = node.calls.begin(),
+            e = node.calls.end(); i != e; ++i)
+          out.push_back(std::make_pair(-score, *i));
+        return;
+      }
+      for (std::vector<std::string>::const_iterator k = keys[arg].begin(),
+          ke = keys[arg].end(); k != ke; ++k) {
+        StringMap<unsigned>::const_iterator c = node.exact.find(*k);
+        if (c != node.exact.end())
+          match(c->second, keys, arg + 1, score + EXACT_MATCH, out);
+      }
+      if (node.wildcard >= 0)
+        match(node.wildcard, keys, arg + 1, score + LOOSE_MATCH, out);
+    }
+
+  public:
+    RewriteMatcher(const std::vector<CallInfo*>& calls)
+      : nodes(1), size(calls.size())
+    {
+      for (unsigned pos = 0; pos < calls.size(); pos++) {
+        unsigned n = 0;
+        const std::vector<PrevirtType>& args = calls[pos]->args;
+        for (std::vector<PrevirtType>::const_iterator a = args.begin(),
+            ae = args.end(); a != ae; ++a) {
+          unsigned child = nodes.size();
+          if (a->isUnknown()) {
+            if (nodes[n].wildcard >= 0) {
+              child = nodes[n].wildcard;
+            } else {
+              nodes[n].wildcard = child;
+            }
+          } else {
+            std::string key;
+            a->encode(key);
+            child = nodes[n].exact.insert(std::make_pair(key, child)).first->second;
+          }
+          if (child == nodes.size())
+            nodes.push_back(Node());
+          n = child;
+        }
+        nodes[n].calls.push_back(pos);
+      }
+    }
+
+    bool
+    isCompiled(const std::vector<CallInfo*>& calls) const
+    {
+      return size == calls.size();
+    }
+
+    // Return the position of the call refined by the arguments with
+    // the largest score (the first one in case of ties), or -1.
+    int
+    lookup(const std::vector<CallInfo*>& calls,
+        User::op_iterator op_begin, User::op_iterator op_end) const
+    {
+      std::vector<std::vector<std::string> > keys;
+      for (User::op_iterator i = op_begin; i != op_end; ++i) {
+        keys.push_back(std::vector<std::string>());
+        PrevirtType::encodeMatches(i->get(), keys.back());
+      }
+
+      std::vector<std::pair<int, unsigned> > candidates;
+      match(0, keys, 0, 0, candidates);
+      std::sort(candidates.begin(), candidates.end());
+
+      // The encodings of an argument over-approximate the types that it
+      // refines, so the candidates are checked in order.
+      for (std::vector<std::pair<int, unsigned> >::const_iterator
+          c = candidates.begin(), ce = candidates.end(); c != ce; ++c) {
+        if (calls[c->second]->refines(op_begin, op_end) != NO_MATCH)
+          return c->second;
+      }
+      return -1;
+    }
+  };
+
   // ComponentInterfaceTransform
   template<>
     void
@@ -436,6 +668,7 @@ namespace previrt
       }
       codeInto<proto::ComponentInterface, ComponentInterface> (buf,
           *ci.interface);
+      ci.compile();
     }
 
   template<>
@@ -463,6 +696,7 @@ namespace previrt
         codeInto<proto::CallRewrite, CallRewrite> (rw, rewrite);
         ci.rewrite(name, result, rewrite);
       }
+      ci.compile();
     }
 
   ComponentInterfaceTransform::ComponentInterfaceTransform() :
@@ -481,6 +715,9 @@ namespace previrt
     if (ownsIface && interface) {
       delete interface;
     }
+    for (std::map<FunctionHandle, RewriteMatcher*>::iterator i =
+        matchers.begin(), e = matchers.end(); i != e; ++i)
+      delete i->second;
   }
 
   void
@@ -504,6 +741,60 @@ namespace previrt
         const CallRewrite>(from, to));
   }
 
+  void
+  ComponentInterfaceTransform::join(const ComponentInterfaceTransform& other)
+  {
+    if (this->interface == NULL) {
+      this->ownsIface = true;
+      this->interface = new ComponentInterface();
+    }
+    for (FMap::const_iterator i = other.rewrites.begin(), e =
+        other.rewrites.end(); i != e; ++i) {
+      for (CMap::const_iterator ii = i->second.begin(), ee = i->second.end(); ii
+          != ee; ++ii) {
+        CallInfo* result = this->interface->getOrCreateCall(i->first,
+            ii->first->args);
+        result->count += ii->first->count;
+        rewrite(i->first, result, ii->second);
+      }
+    }
+    compile();
+  }
+
+  void
+  ComponentInterfaceTransform::retarget(FunctionHandle from, FunctionHandle to)
+  {
+    for (FMap::iterator i = this->rewrites.begin(), e = this->rewrites.end();
+        i != e; ++i) {
+      CMap& calls = i->second;
+      for (CMap::iterator ii = calls.begin(); ii != calls.end();) {
+        if (ii->second.function != from) {
+          ++ii;
+          continue;
+        }
+        const CallInfo* const call = ii->first;
+        const CallRewrite rw(to, ii->second.args);
+        ii = calls.erase(ii);
+        calls.insert(ii, std::pair<const CallInfo* const , const CallRewrite>(call, rw));
+      }
+    }
+  }
+
+  void
+  ComponentInterfaceTransform::compile()
+  {
+    if (this->interface == NULL)
+      return;
+    for (ComponentInterface::FunctionIterator f = interface->begin(),
+        fe = interface->end(); f != fe; ++f) {
+      RewriteMatcher*& m = matchers[f->first().str()];
+      if (m != NULL && m->isCompiled(f->second))
+        continue;
+      delete m;
+      m = new RewriteMatcher(f->second);
+    }
+  }
+
   void
   ComponentInterfaceTransform::dump() const
   {
@@ -552,6 +843,16 @@ namespace previrt
       return NULL;
     }
 
+    std::map<FunctionHandle, RewriteMatcher*>::const_iterator m =
+        matchers.find(name);
+    if (m != matchers.end() && m->second->isCompiled(itr->second)) {
+      int pos = m->second->lookup(itr->second, op_begin, op_end);
+      if (pos >= 0)
+        return this->lookupRewrite(name, itr->second[pos]);
+      return NULL;
+    }
+
+    // The calls changed since the last compile()
     for (ComponentInterface::CallIterator begin = this->interface->call_begin(
         itr), end = this->interface->call_end(itr); begin != end; ++begin) {
       int tscore = (*begin)->refines(op_begin, op_end);
@@ -588,6 +889,12 @@ namespace previrt
       const std::string& filename)
   {
     assert(filename != "");
+    if (std::unique_ptr<MappedInterface> mapped = MappedInterface::open(filename)) {
+      if (mapped->isTransform())
+        return false;
+      mapped->readInto(*this);
+      return true;
+    }
     std::ifstream input(filename.c_str(), std::ios::binary);
     if (input.fail()) {
       return false;
@@ -608,6 +915,12 @@ namespace previrt
       const std::string& filename)
   {
     assert(filename != "");
+    if (std::unique_ptr<MappedInterface> mapped = MappedInterface::open(filename)) {
+      if (!mapped->isTransform())
+        return false;
+      mapped->readInto(*this);
+      return true;
+    }
     std::ifstream input(filename.c_str(), std::ios::binary);
     if (input.fail()) {
       return false;
@@ -0,0 +1,389 @@
+//
+// OCCAM
+//
+// Copyright (c) 2020, SRI International
+//
+//  All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of SRI International nor the names of its contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "ProfitableSpecPolicy.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallBitVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+#define PSP_LOG(...) __VA_ARGS__
+//#define PSP_LOG(...)
+
+namespace previrt {
+
+  namespace {
+    /*
+     * Propagate the constant arguments forward through a function and
+     * count what they remove. Only the effects of the arguments are
+     * counted: instructions that are constant anyway are not.
+     */
+    class SavingsEstimator {
+      const Function& m_F;
+      const DataLayout& m_DL;
+      // values known to be constant
+      DenseMap<const Value*, Constant*> m_known;
+      // values (and branches) that are constant because of the arguments
+      SmallPtrSet<const Value*, 32> m_derived;
+      // blocks already processed, in reverse post-order
+      SmallPtrSet<const BasicBlock*, 32> m_visited;
+      SmallPtrSet<const BasicBlock*, 32> m_reachable;
+      DenseSet<std::pair<const BasicBlock*, const BasicBlock*>> m_edges;
+
+      Constant* lookup(const Value* v) const {
+	if (const Constant* c = dyn_cast<Constant>(v)) {
+	  return const_cast<Constant*>(c);
+	}
+	auto it = m_known.find(v);
+	return it == m_known.end() ? nullptr : it->second;
+      }
+
+      bool isDerived(const Value* v) const {
+	return m_derived.count(v) > 0;
+      }
+
+      void markEdge(const BasicBlock* from, const BasicBlock* to) {
+	m_edges.insert(std::make_pair(from, to));
+	m_reachable.insert(to);
+      }
+
+      Constant* foldPHI(const PHINode& phi, bool& derived) {
+	Constant* result = nullptr;
+	for (unsigned i = 0, e = phi.getNumIncomingValues(); i < e; ++i) {
+	  const BasicBlock* pred = phi.getIncomingBlock(i);
+	  if (!m_edges.count(std::make_pair(pred, phi.getParent()))) {
+	    if (!m_visited.count(pred)) {
+	      // back edge
+	      return nullptr;
+	    }
+	    // infeasible edge
+	    derived |= isDerived(pred->getTerminator());
+	    continue;
+	  }
+	  const Value* v = phi.getIncomingValue(i);
+	  Constant* c = lookup(v);
+	  if (!c || (result && c != result)) {
+	    return nullptr;
+	  }
+	  result = c;
+	  derived |= isDerived(v);
+	}
+	return result;
+      }
+
+      Constant* fold(const Instruction& I, bool& derived) {
+	derived = false;
+	if (const PHINode* phi = dyn_cast<PHINode>(&I)) {
+	  return foldPHI(*phi, derived);
+	}
+	SmallVector<Constant*, 4> ops;
+	for (const Value* op: I.operand_values()) {
+	  Constant* c = lookup(op);
+	  if (!c) {
+	    return nullptr;
+	  }
+	  ops.push_back(c);
+	  derived |= isDerived(op);
+	}
+	if (const CmpInst* cmp = dyn_cast<CmpInst>(&I)) {
+	  return ConstantFoldCompareInstOperands(cmp->getPredicate(), ops[0], ops[1], m_DL);
+	}
+	if (const LoadInst* load = dyn_cast<LoadInst>(&I)) {
+	  if (load->isVolatile()) {
+	    return nullptr;
+	  }
+	  return ConstantFoldLoadFromConstPtr(ops[0], load->getType(), m_DL);
+	}
+	if (I.mayHaveSideEffects()) {
+	  return nullptr;
+	}
+	return ConstantFoldInstOperands(const_cast<Instruction*>(&I), ops, m_DL);
+      }
+
+      // Mark the feasible successors of BB. Return 1 if its branch is
+      // decided by the arguments.
+      unsigned visitTerminator(const BasicBlock& BB) {
+	const Instruction* T = BB.getTerminator();
+	const Value* cond = nullptr;
+	const BasicBlock* target = nullptr;
+	if (const BranchInst* br = dyn_cast<BranchInst>(T)) {
+	  if (br->isConditional()) {
+	    cond = br->getCondition();
+	    if (ConstantInt* c = dyn_cast_or_null<ConstantInt>(lookup(cond))) {
+	      target = br->getSuccessor(c->isZero() ? 1 : 0);
+	    }
+	  }
+	} else if (const SwitchInst* sw = dyn_cast<SwitchInst>(T)) {
+	  cond = sw->getCondition();
+	  if (ConstantInt* c = dyn_cast_or_null<ConstantInt>(lookup(cond))) {
+	    target = const_cast<SwitchInst*>(sw)->findCaseValue(c)->getCaseSuccessor();
+	  }
+	}
+
+	if (target) {
+	  markEdge(&BB, target);
+	  if (isDerived(cond)) {
+	    m_derived.insert(T);
+	    return 1;
+	  }
+	  return 0;
+	}
+	for (const BasicBlock* succ: successors(&BB)) {
+	  markEdge(&BB, succ);
+	}
+	return 0;
+      }
+
+      // Return true if v is a header phi of L that starts with a
+      // constant and is incremented by a constant, or such a phi plus
+      // a constant.
+      bool isCountedInduction(const Loop& L, const Value* v, bool& derived) {
+	if (const BinaryOperator* bo = dyn_cast<BinaryOperator>(v)) {
+	  if (bo->getOpcode() != Instruction::Add && bo->getOpcode() != Instruction::Sub) {
+	    return false;
+	  }
+	  if (!lookup(bo->getOperand(1))) {
+	    return false;
+	  }
+	  v = bo->getOperand(0);
+	}
+	const PHINode* phi = dyn_cast<PHINode>(v);
+	if (!phi || phi->getParent() != L.getHeader() || phi->getNumIncomingValues() != 2) {
+	  return false;
+	}
+	bool start = false, step = false;
+	for (unsigned i = 0; i < 2; ++i) {
+	  const Value* in = phi->getIncomingValue(i);
+	  if (!L.contains(phi->getIncomingBlock(i))) {
+	    if (!lookup(in)) {
+	      return false;
+	    }
+	    derived |= isDerived(in);
+	    start = true;
+	  } else if (const BinaryOperator* inc = dyn_cast<BinaryOperator>(in)) {
+	    step = (inc->getOpcode() == Instruction::Add || inc->getOpcode() == Instruction::Sub) &&
+	      inc->getOperand(0) == phi && lookup(inc->getOperand(1));
+	  }
+	}
+	return start && step;
+      }
+
+      // Return true if the trip count of L becomes constant because of
+      // the arguments.
+      bool hasDerivedTripCount(const Loop& L) {
+	const BasicBlock* exiting = L.getExitingBlock();
+	if (!exiting) {
+	  return false;
+	}
+	const BranchInst* br = dyn_cast<BranchInst>(exiting->getTerminator());
+	if (!br || !br->isConditional()) {
+	  return false;
+	}
+	const ICmpInst* cmp = dyn_cast<ICmpInst>(br->getCondition());
+	if (!cmp) {
+	  return false;
+	}
+	bool derived = false;
+	for (unsigned i = 0; i < 2; ++i) {
+	  const Value* op = cmp->getOperand(i);
+	  if (lookup(op)) {
+	    derived |= isDerived(op);
+	  } else if (!isCountedInduction(L, op, derived)) {
+	    return false;
+	  }
+	}
+	return derived;
+      }
+
+      unsigned loopSavings() {
+	DominatorTree DT(const_cast<Function&>(m_F));
+	LoopInfo LI(DT);
+	unsigned savings = 0;
+	SmallVector<Loop*, 8> loops(LI.begin(), LI.end());
+	while (!loops.empty()) {
+	  Loop* L = loops.pop_back_val();
+	  loops.append(L->begin(), L->end());
+	  if (!m_reachable.count(L->getHeader()) || !hasDerivedTripCount(*L)) {
+	    continue;
+	  }
+	  for (const BasicBlock* BB: L->blocks()) {
+	    if (m_reachable.count(BB)) {
+	      savings += BB->size();
+	    }
+	  }
+	}
+	return savings;
+      }
+
+    public:
+      SavingsEstimator(const Function& F)
+	: m_F(F), m_DL(F.getParent()->getDataLayout()) {}
+
+      unsigned run(const std::vector<Constant*>& args) {
+	unsigned i = 0;
+	for (const Argument& a: m_F.args()) {
+	  if (i < args.size() && args[i]) {
+	    m_known[&a] = args[i];
+	    m_derived.insert(&a);
+	  }
+	  ++i;
+	}
+
+	unsigned folded = 0, dead = 0;
+	m_reachable.insert(&m_F.getEntryBlock());
+	ReversePostOrderTraversal<const Function*> rpo(&m_F);
+	for (const BasicBlock* BB: rpo) {
+	  if (!m_reachable.count(BB)) {
+	    m_visited.insert(BB);
+	    dead += BB->size();
+	    continue;
+	  }
+	  for (const Instruction& I: *BB) {
+	    if (&I == BB->getTerminator()) {
+	      folded += visitTerminator(*BB);
+	      break;
+	    }
+	    bool derived;
+	    if (Constant* c = fold(I, derived)) {
+	      m_known[&I] = c;
+	      if (derived) {
+		m_derived.insert(&I);
+		folded++;
+	      }
+	    }
+	  }
+	  // after the phis of BB so that a self loop is a back edge
+	  m_visited.insert(BB);
+	}
+	return folded + dead + loopSavings();
+      }
+    };
+  } // end anonymous namespace
+
+  unsigned ProfitableSpecPolicy::estimateSavings(const Function& F,
+						 const std::vector<Constant*>& args) {
+    if (F.isDeclaration()) {
+      return 0;
+    }
+    SavingsEstimator estimator(F);
+    return estimator.run(args);
+  }
+
+  static void concreteArgs(const Function& F, const std::vector<PrevirtType>& args,
+			   const SmallBitVector& marks, std::vector<Constant*>& csts) {
+    Module& M = *const_cast<Module*>(F.getParent());
+    csts.assign(F.arg_size(), nullptr);
+    for (unsigned i = 0, e = std::min(args.size(), csts.size()); i < e; ++i) {
+      PrevirtType::Kind kind = args[i].getKind();
+      if (!marks.test(i) ||
+	  (kind != PrevirtType::INT && kind != PrevirtType::FLOAT &&
+	   kind != PrevirtType::NUL)) {
+	continue;
+      }
+      Type* type = F.getFunctionType()->getParamType(i);
+      csts[i] = dyn_cast<Constant>(args[i].concretize(M, type));
+    }
+  }
+
+  unsigned ProfitableSpecPolicy::estimateSavings(const Function& F,
+						 const std::vector<PrevirtType>& args,
+						 const SmallBitVector& marks) {
+    std::vector<Constant*> csts;
+    concreteArgs(F, args, marks, csts);
+    return estimateSavings(F, csts);
+  }
+
+  ProfitableSpecPolicy::ProfitableSpecPolicy(std::unique_ptr<SpecializationPolicy> subpolicy,
+					     unsigned ratio)
+    : m_subpolicy(std::move(subpolicy))
+    , m_ratio(ratio) {}
+
+  bool ProfitableSpecPolicy::isProfitable(const Function& F,
+					  const std::vector<Constant*>& args) const {
+    unsigned size = 0;
+    for (const BasicBlock& BB: F) {
+      size += BB.size();
+    }
+    if (size == 0) {
+      return false;
+    }
+    unsigned savings = std::min(estimateSavings(F, args), size);
+    bool res = savings > 0 && (uint64_t) savings * 100 >= (uint64_t) m_ratio * size;
+    PSP_LOG(errs() << "[PSP] specializing " << F.getName() << " removes about "
+	    << savings << " of " << size << " instructions: "
+	    << (res ? "yes\n" : "no\n"););
+    return res;
+  }
+
+  bool ProfitableSpecPolicy::intraSpecializeOn(CallSite CS,
+					       std::vector<Value*>& marks) {
+    const Function* calleeF = CS.getCalledFunction();
+    if (!calleeF) {
+      return false;
+    }
+    if (!m_subpolicy->intraSpecializeOn(CS, marks)) {
+      return false;
+    }
+    std::vector<Constant*> args;
+    args.reserve(marks.size());
+    for (Value* v: marks) {
+      args.push_back(dyn_cast_or_null<Constant>(v));
+    }
+    return isProfitable(*calleeF, args);
+  }
+
+  bool ProfitableSpecPolicy::interSpecializeOn(const Function& calleeF,
+					       const std::vector<PrevirtType>& args,
+					       const ComponentInterface& interface,
+					       SmallBitVector& marks) {
+    if (!m_subpolicy->interSpecializeOn(calleeF, args, interface, marks)) {
+      return false;
+    }
+    std::vector<Constant*> csts;
+    concreteArgs(calleeF, args, marks, csts);
+    return isProfitable(calleeF, csts);
+  }
+
+} // end namespace previrt
@@ -0,0 +1,126 @@
+//
+// OCCAM
+//
+// Copyright (c) 2020, SRI International
+//
+//  All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of SRI International nor the names of its contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "SpecializationBudget.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Type.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+namespace previrt {
+
+  static const char* BudgetMDName = "previrt.budget";
+
+  static uint64_t readOperand(const MDNode* node, unsigned i) {
+    if (i < node->getNumOperands()) {
+      if (ConstantInt* c = mdconst::dyn_extract_or_null<ConstantInt>(node->getOperand(i))) {
+	return c->getZExtValue();
+      }
+    }
+    return 0;
+  }
+  
+  SpecializationBudget::SpecializationBudget(Module& M, unsigned percent)
+    : m_M(&M), m_total(0), m_spent(0) {
+    
+    if (NamedMDNode* md = M.getNamedMetadata(BudgetMDName)) {
+      if (md->getNumOperands() > 0) {
+	const MDNode* node = md->getOperand(0);
+	m_total = readOperand(node, 0);
+	m_spent = readOperand(node, 1);
+	return;
+      }
+    }
+
+    if (percent == 0) {
+      return;
+    }
+    uint64_t size = 0;
+    for (const Function& F: M) {
+      for (const BasicBlock& BB: F) {
+	size += BB.size();
+      }
+    }
+    // at least one instruction so that the budget is limited
+    m_total = std::max<uint64_t>(1, size * percent / 100);
+  }
+
+  SpecializationBudget::SpecializationBudget(const std::vector<Module*>& modules,
+					     unsigned percent)
+    : m_M(nullptr), m_total(0), m_spent(0) {
+    for (Module* M: modules) {
+      SpecializationBudget budget(*M, percent);
+      m_total += budget.total();
+      m_spent += budget.spent();
+    }
+  }
+
+  bool SpecializationBudget::canAfford(uint64_t cost) const {
+    return !isLimited() || m_spent + cost <= m_total;
+  }
+
+  void SpecializationBudget::spend(uint64_t cost) {
+    m_spent += cost;
+  }
+
+  void SpecializationBudget::save() const {
+    if (!m_M || !isLimited()) {
+      return;
+    }
+    LLVMContext& ctx = m_M->getContext();
+    Type* i64 = Type::getInt64Ty(ctx);
+    Metadata* ops[] = {
+      ConstantAsMetadata::get(ConstantInt::get(i64, m_total)),
+      ConstantAsMetadata::get(ConstantInt::get(i64, m_spent))
+    };
+    NamedMDNode* md = m_M->getOrInsertNamedMetadata(BudgetMDName);
+    md->clearOperands();
+    md->addOperand(MDNode::get(ctx, ops));
+  }
+
+  void SpecializationBudget::rank(std::vector<Candidate>& candidates) {
+    // benefit1/cost1 > benefit2/cost2 without dividing. Free
+    // candidates come first.
+    std::stable_sort(candidates.begin(), candidates.end(),
+		     [](const Candidate& c1, const Candidate& c2) {
+		       uint64_t b1 = std::max<uint64_t>(c1.benefit, 1);
+		       uint64_t b2 = std::max<uint64_t>(c2.benefit, 1);
+		       return b1 * c2.cost > b2 * c1.cost;
+		     });
+  }
+  
+} // end namespace previrt
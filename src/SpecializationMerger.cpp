@@ -0,0 +1,128 @@
+//
+// OCCAM
+//
+// Copyright (c) 2020, SRI International
+//
+//  All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of SRI International nor the names of its contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "SpecializationMerger.h"
+#include "SpecializationTable.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/FunctionComparator.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <vector>
+
+using namespace llvm;
+
+namespace previrt {
+
+  /* Replace from with to, which has the same type */
+  static void fold(Function* from, Function* to, SpecializationTable& table) {
+    table.replaceSpecialization(from, to);
+    
+    const std::string name = from->getName().str();
+    const bool external = !from->hasLocalLinkage();
+    const GlobalValue::LinkageTypes linkage = from->getLinkage();
+    from->replaceAllUsesWith(to);
+    from->eraseFromParent();
+    if (external) {
+      GlobalAlias::create(linkage, name, to);
+    }
+  }
+  
+  unsigned mergeSpecializations(Module& M, SpecializationTable& table,
+				std::map<std::string, std::string>& folded) {
+    GlobalNumberState numbers;
+    unsigned count = 0;
+    bool change = true;
+    // Folding some copies can make their callers identical
+    while (change) {
+      change = false;
+
+      // -- group the copies by principal function and structural hash,
+      //    in module order
+      typedef std::pair<const Function*, FunctionComparator::FunctionHash> Key;
+      DenseMap<Key, unsigned> bucketOf;
+      std::vector<std::vector<Function*> > buckets;
+      for (Function& F: M) {
+	if (F.isDeclaration() || F.isInterposable() || !table.isSpecialization(&F)) {
+	  continue;
+	}
+	Key key(table.getPrincipalFunction(&F), FunctionComparator::functionHash(F));
+	auto it = bucketOf.find(key);
+	if (it == bucketOf.end()) {
+	  bucketOf[key] = buckets.size();
+	  buckets.push_back(std::vector<Function*>(1, &F));
+	} else {
+	  buckets[it->second].push_back(&F);
+	}
+      }
+
+      for (std::vector<Function*>& bucket: buckets) {
+	// the copies that are kept
+	std::vector<Function*> kept;
+	for (Function* F: bucket) {
+	  Function* same = nullptr;
+	  for (Function* G: kept) {
+	    if (FunctionComparator(G, F, &numbers).compare() == 0) {
+	      same = G;
+	      break;
+	    }
+	  }
+	  if (!same) {
+	    kept.push_back(F);
+	    continue;
+	  }
+	  errs() << "Merging " << F->getName() << " into " << same->getName() << "\n";
+	  folded[F->getName().str()] = same->getName().str();
+	  numbers.erase(F);
+	  fold(F, same, table);
+	  count++;
+	  change = true;
+	}
+      }
+    }
+
+    // -- a name folded into a copy that was folded later
+    for (auto& kv: folded) {
+      auto it = folded.find(kv.second);
+      while (it != folded.end()) {
+	kv.second = it->second;
+	it = folded.find(kv.second);
+      }
+    }
+    return count;
+  }
+  
+} // end namespace previrt
@@ -38,10 +38,12 @@
 
 #include "SpecializationTable.h"
 
+#include "llvm/ADT/Hashing.h"
 #include "llvm/IR/Value.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
@@ -51,8 +53,10 @@ namespace previrt
   
   typedef SpecializationTable::Specialization Specialization;
 
+  static const char* LedgerMDName = "previrt::specializations";
+
   /* Return true if l refines r */
-  bool Specialization::refines(SpecScheme l, SpecScheme r) {
+  bool Specialization::refines(const SpecScheme& l, const SpecScheme& r) {
     assert(l.size() == r.size());
     for (unsigned i = 0, e = l.size(); i < e; i++) {
       if (!r[i])
@@ -73,82 +77,131 @@ namespace previrt
   }
 
   void SpecializationTable::initialize(Module* m) {
-    // XXX: RECORD_IN_METADATA seems an old option.
-    //      TODO: figure out if we can remove this code.
     assert(this->module == NULL);
     
     this->module = m;
-#ifdef RECORD_IN_METADATA
-    // Parse the module metadata to populate the table
-    NamedMDNode* specs = m->getNamedMetadata("previrt::specializations");
-    if (specs == NULL)
-    return;
 
-    errs() << "Specialization Count: " << specs->getNumOperands() << "\n";
+    // Load the specializations made by earlier runs. The ledger is in
+    // creation order so a parent is always loaded before its children.
+    NamedMDNode* ledger = m->getNamedMetadata(LedgerMDName);
+    if (ledger == NULL) {
+      return;
+    }
 
-    for (unsigned int i = 0; i < specs->getNumOperands(); ++i) {
-      MDNode* funNode = specs->getOperand(i);
-      if (funNode == NULL) {
-        continue;
+    std::vector<MDNode*> live;
+    live.reserve(ledger->getNumOperands());
+    for (unsigned i = 0, e = ledger->getNumOperands(); i < e; ++i) {
+      MDNode* node = ledger->getOperand(i);
+      if (node->getNumOperands() < 2) {
+	continue;
       }
-      assert (funNode->getNumOperands() > 2);
-      MDString* prinName = dyn_cast_or_null<MDString>(funNode->getOperand(0));
-      MDString* specName = dyn_cast_or_null<MDString>(funNode->getOperand(1));
-      if (prinName == NULL || specName == NULL) {
-        errs() << "must skip " << (prinName == NULL ? "?" : prinName->getString()) << "\n";
-        continue;
-      }
-      Function* prin = m->getFunction(prinName->getString());
-      Function* spec = m->getFunction(specName->getString());
-      if (prin == NULL || spec == NULL) {
-        errs() << "must skip " << (prin == NULL ? "?" : prin->getName()) << "\n";
-        continue;
+      // The operands become null if the functions were deleted
+      Function* parent = mdconst::dyn_extract_or_null<Function>(node->getOperand(0));
+      Function* spec = mdconst::dyn_extract_or_null<Function>(node->getOperand(1));
+      if (parent == NULL || spec == NULL ||
+	  node->getNumOperands() != 2 + parent->arg_size()) {
+	continue;
       }
 
-      const unsigned int arg_count = prin->getArgumentList().size();
-      if (funNode->getNumOperands() != 2 + arg_count) {
-        continue;
-      }
-      
       SpecScheme scheme;
-      scheme.reserve(arg_count);
-      for (unsigned int i = 0; i < arg_count; i++) {
-        Value* opr = funNode->getOperand(2 + i);
-        if (opr == NULL) {
-          scheme.push_back(nullptr);
-        } else {
-          assert (dyn_cast<Constant>(opr) != NULL);
-          scheme.push_pack(opr);
-        }
+      scheme.reserve(parent->arg_size());
+      unsigned holes = 0;
+      for (unsigned j = 2, je = node->getNumOperands(); j < je; ++j) {
+	Constant* c = mdconst::dyn_extract_or_null<Constant>(node->getOperand(j));
+	scheme.push_back(c);
+	if (c == NULL) {
+	  holes++;
+	}
+      }
+      // one of the constants was deleted
+      if (holes != spec->arg_size()) {
+	continue;
+      }
+
+      if (this->specialized.count(spec)) {
+	// the copy of another scheme was merged into spec
+	this->insert(parent, scheme, spec);
+      } else {
+	this->addSpecialization(parent, scheme, spec, false);
       }
+      live.push_back(node);
+    }
 
-      this->addSpecialization(prin, scheme, spec, false);
-      errs() << "recording specialization of '" << prin->getName() << "' to '" << spec->getName() << "'\n";
+    // -- drop the stale entries
+    if (live.size() != ledger->getNumOperands()) {
+      ledger->clearOperands();
+      for (MDNode* node: live) {
+	ledger->addOperand(node);
+      }
     }
-#endif /* RECORD_IN_METADATA */
   }
 
   SpecializationTable::~SpecializationTable() {
-    for (SpecTable::iterator i = this->specialized.begin(), e =
-	   this->specialized.end(); i != e; ++i) {
-      delete i->second;
-    }
+    // the nodes are destroyed with the arena
   }
 
+  static size_t hashScheme(const Specialization* parent,
+			   const SpecializationTable::SpecScheme& scheme) {
+    return hash_combine(parent, hash_combine_range(scheme.begin(), scheme.end()));
+  }
 
-  void SpecializationTable::getSpecializations(Function* f, SpecScheme scheme,
+  void SpecializationTable::getSpecializations(Function* f, const SpecScheme& scheme,
 					       std::vector<const Specialization*>& result) const
   {
     const Specialization* current = this->getSpecialization(f);
+
+    // Only the children that have the same constant as scheme at its
+    // most selective position can refine it.
+    const std::vector<Specialization*>* candidates = &current->children;
+    for (unsigned i = 0, e = scheme.size(); i < e; i++) {
+      if (!scheme[i])
+	continue;
+      auto it = byArg.find(std::make_pair(current, std::make_pair(i, scheme[i])));
+      if (it == byArg.end())
+	return;
+      if (it->second.size() < candidates->size())
+	candidates = &it->second;
+    }
+
     for (std::vector<Specialization*>::const_iterator i =
-        current->children.begin(), e = current->children.end(); i != e; ++i) {
+        candidates->begin(), e = candidates->end(); i != e; ++i) {
       if (Specialization::refines((*i)->args, scheme)) {
         result.push_back(*i);
       }
     }
   }
 
-  bool SpecializationTable::addSpecialization(Function* parent, SpecScheme scheme,
+  const Specialization* SpecializationTable::lookupSpecialization(Function* f,
+								  const SpecScheme& scheme) const {
+    const Specialization* current = this->getSpecialization(f);
+    auto range = byScheme.equal_range(hashScheme(current, scheme));
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second->parent == current && it->second->args == scheme) {
+	return it->second;
+      }
+    }
+    return nullptr;
+  }
+
+  Specialization* SpecializationTable::insert(Function* parent, const SpecScheme& scheme,
+					      Function* handle) {
+    Specialization* parentSpec = this->getSpecialization(parent);
+    Specialization* spec = new (arena.Allocate()) Specialization();
+    spec->handle = handle;
+    spec->parent = parentSpec;
+    spec->args = scheme;
+
+    parentSpec->children.push_back(spec);
+    byScheme.insert(std::make_pair(hashScheme(parentSpec, scheme), spec));
+    for (unsigned i = 0, e = scheme.size(); i < e; i++) {
+      if (scheme[i]) {
+	byArg[std::make_pair(parentSpec, std::make_pair(i, scheme[i]))].push_back(spec);
+      }
+    }
+    return spec;
+  }
+
+  bool SpecializationTable::addSpecialization(Function* parent, const SpecScheme& scheme,
 					      Function* specialization, bool record) {
     assert(parent != NULL);
     assert(specialization != NULL);
@@ -159,50 +212,61 @@ namespace previrt
       return false;
     }
 
-    Specialization* parentSpec = this->getSpecialization(parent);
-    Specialization* spec = new Specialization();
-    spec->handle = specialization;
-    spec->parent = parentSpec;
-    std::copy(scheme.begin(), scheme.end(), std::back_inserter(spec->args));
+    Specialization* spec = this->insert(parent, scheme, specialization);
     this->specialized[specialization] = spec;
 
-    //.GetOrCreateValue(specialization->getName(), spec);
-    parentSpec->children.push_back(spec);
-
-#if RECORD_IN_METADATA
-    // Add the meta-data
-    if (record) {
-      NamedMDNode* md = this->module->getOrInsertNamedMetadata(
-          "previrt::specializations");
-
-      const unsigned int arg_count = parent->getArgumentList().size();
-      Value** vals = new Value*[2 + arg_count];
-      vals[0] = MDString::get(parent->getContext(), parent->getName());
-      vals[1] = MDString::get(parent->getContext(), specialization->getName());
-      for (unsigned int i = 0; i < parent->getArgumentList().size(); ++i) {
-        vals[i+2] = scheme[i];
+    if (record && this->module != NULL) {
+      // !{parent, specialization, scheme...} where a null operand is an
+      // argument that was not specialized.
+      NamedMDNode* ledger = this->module->getOrInsertNamedMetadata(LedgerMDName);
+      std::vector<Metadata*> ops;
+      ops.reserve(2 + scheme.size());
+      ops.push_back(ValueAsMetadata::get(parent));
+      ops.push_back(ValueAsMetadata::get(specialization));
+      for (Value* v: scheme) {
+	ops.push_back(v ? ValueAsMetadata::get(v) : nullptr);
       }
-
-      ArrayRef<Value*> ar_vals(vals, vals+2+arg_count);
-      MDNode* nde = MDNode::get(this->module->getContext(), ar_vals);
-
-      md->addOperand(nde);
+      ledger->addOperand(MDNode::get(this->module->getContext(), ops));
     }
-#endif /* RECORD_IN_METADATA */
 
     return true;
   }
 
   Specialization* SpecializationTable::getSpecialization(Function* f) const {
-    SpecTable::const_iterator itr = this->specialized.find(f);
-    if (itr == this->specialized.end()) {
-      Specialization* spec = new Specialization();
+    Specialization*& spec = this->specialized[f];
+    if (!spec) {
+      spec = new (arena.Allocate()) Specialization();
       spec->parent = NULL;
       spec->handle = f;
-      const_cast<SpecializationTable*> (this)->specialized[f] = spec;
-      return this->specialized[f];
     }
-    return itr->second;
+    return spec;
+  }
+
+  void SpecializationTable::replaceSpecialization(Function* from, Function* to) {
+    SpecTable::iterator it = this->specialized.find(from);
+    if (it == this->specialized.end()) {
+      return;
+    }
+    // The ledger follows when the uses of from are replaced
+    it->second->handle = to;
+    this->specialized.erase(it);
+  }
+
+  bool SpecializationTable::isSpecialization(const Function* f) const {
+    SpecTable::const_iterator it = this->specialized.find(const_cast<Function*>(f));
+    return it != this->specialized.end() && it->second->parent != NULL;
+  }
+
+  const Function* SpecializationTable::getPrincipalFunction(const Function* f) const {
+    SpecTable::const_iterator it = this->specialized.find(const_cast<Function*>(f));
+    if (it == this->specialized.end()) {
+      return f;
+    }
+    const Specialization* spec = it->second;
+    while (spec->parent != NULL) {
+      spec = spec->parent;
+    }
+    return spec->handle;
   }
 
   const Specialization* SpecializationTable::getPrincipalSpecialization(Function* f) const {
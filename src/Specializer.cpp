@@ -37,11 +37,14 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/IR/ValueMap.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 
 #include "llvm/ADT/ArrayRef.h"
@@ -55,49 +58,58 @@ using namespace llvm;
 
 namespace previrt
 {
-  std::string specializeName(Function* f, std::vector<std::string>& args) {
-    assert(f->hasName());
-    
+  static const char* SpecMDName = "previrt.spec";
+  static const char* SpecPrefix = "__occam_spec.";
+
+  /*
+   * Return the name of the function that f was specialized from and
+   * fill args with the abstraction of its arguments ("?" if not
+   * specialized). A specialization keeps them in its !previrt.spec
+   * metadata so nested specializations do not parse names.
+   */
+  static std::string principalScheme(Function* f, std::vector<std::string>& args) {
     args.clear();
-    std::string fn = f->getName().str();
-
-    int idx = fn.find('(');
-    if (idx != -1 && fn[fn.length()-1] == ')') {
-      std::string base = fn.substr(0, idx);
-      idx++;
-      unsigned int st = idx;
-      bool in_str = false;
-      while (st < fn.length()-1) {
-        idx = st;
-        while (true) {
-          if (fn[idx] == '"') {
-            in_str = !in_str;
-          } else if (!in_str) {
-            if (fn[idx] == ',') {
-              args.push_back(fn.substr(st, idx-st));
-              break;
-            } else if (fn[idx] == ')') {
-              args.push_back(fn.substr(st, idx-st));
-              break;
-            }
-          } else {
-            if (fn[idx] == '\\') {
-              idx += 2;
-            }
-          }
-          idx++;
-        }
-        st = idx + 1;
+    if (MDNode* md = f->getMetadata(SpecMDName)) {
+      if (md->getNumOperands() > 0) {
+	for (unsigned i = 1, e = md->getNumOperands(); i < e; ++i) {
+	  args.push_back(cast<MDString>(md->getOperand(i))->getString().str());
+	}
+	return cast<MDString>(md->getOperand(0))->getString().str();
       }
-      return base;
-    } else {
-      unsigned alen = f->arg_size();
-      args.reserve(alen);
-      for (unsigned int i = 0; i < alen; ++i) {
-        args.push_back("?");
-      }
-      return "__occam_spec." + f->getName().str();
     }
+    args.assign(f->arg_size(), "?");
+    return f->getName().str();
+  }
+
+  static MDNode* schemeNode(LLVMContext& ctx, const std::string& principal,
+			    const std::vector<std::string>& args) {
+    std::vector<Metadata*> ops;
+    ops.reserve(1 + args.size());
+    ops.push_back(MDString::get(ctx, principal));
+    for (const std::string& a: args) {
+      ops.push_back(MDString::get(ctx, a));
+    }
+    return MDNode::get(ctx, ops);
+  }
+
+  /*
+   * __occam_spec.<principal>.<hash> where hash has 16 hex digits.
+   * The hash only depends on the scheme so the names are the same
+   * across runs.
+   */
+  static std::string specializeName(const std::string& principal,
+				    const std::vector<std::string>& args) {
+    std::string key = principal + "(";
+    for (unsigned i = 0, e = args.size(); i < e; ++i) {
+      if (i > 0) key += ",";
+      key += args[i];
+    }
+    key += ")";
+
+    std::string name;
+    raw_string_ostream out(name);
+    out << SpecPrefix << principal << "." << format_hex_no_prefix(MD5Hash(key), 16);
+    return out.str();
   }
 
   Function* specializeFunction(Function *f, const std::vector<Value*>& args) {
@@ -115,7 +127,7 @@ namespace previrt
     unsigned int j = 0;
     std::vector<std::string> argNames;
     
-    std::string baseName = specializeName(f, argNames);
+    std::string principal = principalScheme(f, argNames);
 
     for (Function::arg_iterator itr = f->arg_begin(); itr != f->arg_end(); itr++, i++) {
       while (argNames[j] != "?") j++;
@@ -133,22 +145,19 @@ namespace previrt
     }
     assert (i == f->arg_size());
 
-    baseName += "(";
-    for (std::vector<std::string>::const_iterator it = argNames.begin(), be = argNames.begin(),
-	   en = argNames.end(); it != en; ++it) {
-      if (it != be) baseName += ",";
-      baseName += *it;
-    }
-    baseName += ")";
+    std::string baseName = specializeName(principal, argNames);
+    MDNode* scheme = schemeNode(f->getContext(), principal, argNames);
 
     Function *result = f->getParent()->getFunction(baseName);
     // If specialized function already exists, no reason
     // to create another one. In fact, can cause the process
-    // to diverge. 
-    if (!result) {
+    // to diverge. On a hash collision the new copy gets a
+    // unique suffix.
+    if (!result || result->getMetadata(SpecMDName) != scheme) {
       ClonedCodeInfo info;
       result = llvm::CloneFunction(f, vmap, &info);
       result->setName(baseName);
+      result->setMetadata(SpecMDName, scheme);
     }
     return result;
   }
@@ -0,0 +1,109 @@
+#include "analysis/ProfileCounts.h"
+
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/BranchProbabilityInfo.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Module.h"
+#include "llvm/ProfileData/InstrProf.h"
+
+namespace previrt {
+namespace analysis {
+
+using namespace llvm;
+
+/* The analyses needed to propagate the entry count to the blocks */
+struct ProfileCounts::FunctionCounts {
+  DominatorTree DT;
+  LoopInfo LI;
+  BranchProbabilityInfo BPI;
+  BlockFrequencyInfo BFI;
+
+  FunctionCounts(Function &F)
+    : DT(F), LI(DT), BPI(F, LI), BFI(F, BPI, LI) {}
+};
+
+// Maximum number of targets read from the value profile of a call
+static const unsigned MaxTargets = 64;
+
+ProfileCounts::ProfileCounts(const Module &M): m_max(0) {
+  for (const Function &F: M) {
+    if (F.isDeclaration()) continue;
+    if (Optional<uint64_t> count = F.getEntryCount()) {
+      m_max = std::max(m_max, *count);
+    }
+    // The profile was attached before internalization, so F may
+    // have been external then even if it is local now.
+    addPGOName(F.getName(), F);
+    if (F.hasLocalLinkage()) {
+      addPGOName(getPGOFuncName(F), F);
+      if (MDNode *md = getPGOFuncNameMetadata(F)) {
+	addPGOName(cast<MDString>(md->getOperand(0))->getString(), F);
+      }
+    }
+  }
+}
+
+void ProfileCounts::addPGOName(StringRef name, const Function &F) {
+  m_by_hash[IndexedInstrProf::ComputeHash(name)] = &F;
+}
+
+ProfileCounts::~ProfileCounts() {}
+
+ProfileCounts::FunctionCounts &ProfileCounts::getCounts(const Function &F) {
+  std::unique_ptr<FunctionCounts> &counts = m_counts[&F];
+  if (!counts) {
+    counts.reset(new FunctionCounts(const_cast<Function&>(F)));
+  }
+  return *counts;
+}
+
+Optional<uint64_t> ProfileCounts::getCount(const BasicBlock &BB) {
+  const Function &F = *BB.getParent();
+  if (!hasProfile() || !F.getEntryCount()) {
+    return None;
+  }
+  return getCounts(F).BFI.getBlockProfileCount(&BB);
+}
+
+bool ProfileCounts::isHot(const Instruction &I, unsigned percent) {
+  Optional<uint64_t> count = getCount(*I.getParent());
+  if (!count) {
+    return true;
+  }
+  return *count * 100 >= percent * m_max;
+}
+
+bool ProfileCounts::isHot(const Function &F, unsigned percent) const {
+  Optional<uint64_t> count = F.getEntryCount();
+  if (!hasProfile() || !count) {
+    return true;
+  }
+  return *count * 100 >= percent * m_max;
+}
+
+void ProfileCounts::getCallTargets(const Instruction &I,
+				   DenseMap<const Function*, uint64_t> &targets) const {
+  InstrProfValueData data[MaxTargets];
+  uint32_t num = 0;
+  uint64_t total = 0;
+  if (!getValueProfDataFromInst(I, IPVK_IndirectCallTarget, MaxTargets,
+				data, num, total)) {
+    return;
+  }
+  for (uint32_t i = 0; i < num; ++i) {
+    auto it = m_by_hash.find(data[i].Value);
+    if (it != m_by_hash.end()) {
+      targets[it->second] += data[i].Count;
+    }
+  }
+}
+
+void ProfileCounts::invalidate(const Function &F) {
+  m_counts.erase(&F);
+}
+
+} // end namespace analysis
+} // end namespace previrt
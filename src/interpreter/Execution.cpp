@@ -1447,6 +1447,7 @@ void Interpreter::visitIndirectBrInst(IndirectBrInst &I) {
 void Interpreter::SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF){
   BasicBlock *PrevBB = SF.CurBB;      // Remember where we came from...
   SF.CurBB   = Dest;                  // Update CurBB to branch destination
+  ++EdgeCounts[std::make_pair(PrevBB, Dest)];
   SF.CurInst = SF.CurBB->begin();     // Update new instruction ptr...
 
   if (!isa<PHINode>(SF.CurInst)) return;  // Nothing fancy to do
@@ -1748,7 +1749,11 @@ void Interpreter::visitCallSite(CallSite CS) {
     LOG << "the called function is unknown\n";
     StopExecution = true;
   } else {
-    callFunction((Function*)GVTOP(SRC.getValue()), ArgVals);
+    Function *Callee = (Function*)GVTOP(SRC.getValue());
+    if (!F) {
+      ++CalleeCounts[CS.getInstruction()][Callee];
+    }
+    callFunction(Callee, ArgVals);
   }
 }
 
@@ -2819,6 +2824,8 @@ void Interpreter::callFunction(Function *F, ArrayRef<AbsGenericValue> ArgVals) {
     return;
   }
 
+  ++FunctionCounts[F];
+
   // Get pointers to first LLVM BB & Instruction in function.
   StackFrame.CurBB     = &F->front();
   StackFrame.CurInst   = StackFrame.CurBB->begin();
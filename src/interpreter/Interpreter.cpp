@@ -170,5 +170,22 @@ GenericValue Interpreter::runFunction(Function *F,
 bool Interpreter::isExecuted(const BasicBlock &BB) const {
   return (VisitedBlocks.count(&BB) > 0);
 }
+
+uint64_t Interpreter::getExecutionCount(const Function &F) const {
+  auto it = FunctionCounts.find(&F);
+  return it == FunctionCounts.end() ? 0 : it->second;
+}
+
+uint64_t Interpreter::getExecutionCount(const BasicBlock &From,
+					const BasicBlock &To) const {
+  auto it = EdgeCounts.find(std::make_pair(&From, &To));
+  return it == EdgeCounts.end() ? 0 : it->second;
+}
+
+const DenseMap<const Function*, uint64_t>*
+Interpreter::getCallees(const Instruction &I) const {
+  auto it = CalleeCounts.find(&I);
+  return it == CalleeCounts.end() ? nullptr : &it->second;
+}
   
 } // end namespace previrt
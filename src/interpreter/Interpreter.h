@@ -170,6 +170,14 @@ class Interpreter : public llvm::ExecutionEngine, public llvm::InstVisitor<Inter
 
   // XXX: keep track of the blocks executed by the interpreter
   llvm::DenseSet<const llvm::BasicBlock*> VisitedBlocks;
+
+  // XXX: execution counts of the functions, of the CFG edges and of
+  // the callees of each indirect call
+  llvm::DenseMap<const llvm::Function*, uint64_t> FunctionCounts;
+  llvm::DenseMap<std::pair<const llvm::BasicBlock*, const llvm::BasicBlock*>,
+		 uint64_t> EdgeCounts;
+  llvm::DenseMap<const llvm::Instruction*,
+		 llvm::DenseMap<const llvm::Function*, uint64_t>> CalleeCounts;
   
 public:
   
@@ -295,6 +303,15 @@ public:
 	       llvm::DenseMap<llvm::Value*, RawAndDerefValue> &StackVals);
 
   bool isExecuted(const llvm::BasicBlock &) const;
+
+  // Number of times the function was called
+  uint64_t getExecutionCount(const llvm::Function &) const;
+  // Number of times the edge From -> To was taken
+  uint64_t getExecutionCount(const llvm::BasicBlock &From,
+			     const llvm::BasicBlock &To) const;
+  // Callees of the indirect call and number of calls to each, or null
+  const llvm::DenseMap<const llvm::Function*, uint64_t>*
+  getCallees(const llvm::Instruction &) const;
   
 private:  // Helper functions
   
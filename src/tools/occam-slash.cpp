@@ -0,0 +1,487 @@
+//
+// OCCAM
+//
+// Copyright (c) 2011-2020, SRI International
+//
+//  All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of SRI International nor the names of its contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+/**
+ * occam-slash: run the slash fixpoint (see razor/slash.py) over all
+ * the modules of a program in a single process.
+ *
+ * razor runs each step of the fixpoint (interface, internalize,
+ * peval, specialize, rewrite and sealing) as a separate opt process
+ * that reads and writes bitcode and interface files.  Here, all the
+ * modules are loaded once in the same LLVMContext, the interfaces and
+ * rewrites are kept in memory, and the bitcode is only written at the
+ * end (or after each step if -Pslash-dump-dir is given).
+ *
+ * The options of the previrt passes (e.g., -Ppeval-policy,
+ * -Pspecialize-policy, -Pkeep-external, -Pdevirt-with-seadsa, etc)
+ * are the same as in opt.
+ **/
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/PassInfo.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+
+#include "Previrtualize.h"
+#include "SpecializationBudget.h"
+#include "utils/Inliner.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace previrt;
+
+static cl::list<std::string>
+InputFilenames(cl::Positional, cl::OneOrMore,
+	       cl::desc("<input bitcode files>"));
+
+static cl::list<std::string>
+OutputFilenames("Pslash-output",
+		cl::desc("Output bitcode file (one per input file and in the same order)"));
+
+static cl::list<std::string>
+EntryInterfaces("Pslash-entry",
+		cl::desc("Interface of the entry points of the program (e.g., main.iface)"));
+
+static cl::opt<unsigned>
+MaxIterations("Pslash-max-iterations",
+	      cl::init(10),
+	      cl::desc("Maximum number of iterations of the global fixpoint"));
+
+static cl::opt<bool>
+Devirtualize("Pslash-devirt",
+	     cl::init(false),
+	     cl::desc("Resolve indirect calls using -Pdevirt before intra-module specialization"));
+
+static cl::opt<bool>
+IPDeadStoreElim("Pslash-ipdse",
+		cl::init(false),
+		cl::desc("Run inter-procedural dead store elimination and -Pipsccp "
+			 "before intra-module specialization"));
+
+static cl::opt<bool>
+InlineBounce("Pslash-inline-bounce",
+	     cl::init(false),
+	     cl::desc("Force inlining of bounce functions generated by devirt"));
+
+static cl::opt<bool>
+InlineSpec("Pslash-inline-spec",
+	   cl::init(false),
+	   cl::desc("Force inlining of functions generated by specialization"));
+
+static cl::opt<std::string>
+DumpDir("Pslash-dump-dir",
+	cl::init(""),
+	cl::desc("Write all the modules into <dir> after each step (for debugging)"));
+
+static cl::opt<unsigned>
+ReoptimizeThreshold("Pslash-reoptimize-threshold",
+		    cl::init(8),
+		    cl::desc("Do not run the whole-module optimizer again if Ppeval reached "
+			     "its fixpoint after changing at most this many functions "
+			     "(razor's peval_reoptimize_threshold)"));
+
+// Same meaning as in opt
+static cl::opt<bool>
+DisableInlining("disable-inlining",
+		cl::init(false),
+		cl::desc("Do not run the inliner pass"));
+
+struct SlashModule {
+  std::string input;
+  std::string output;
+  std::unique_ptr<Module> module;
+  // external dependencies of the module
+  std::unique_ptr<ComponentInterface> interface;
+  // rewrites produced by inter-module specialization
+  std::unique_ptr<ComponentInterfaceTransform> transform;
+};
+
+typedef std::vector<SlashModule> SlashModules;
+
+/* Run the passes registered with names (e.g., "Ppeval") on M */
+static bool runPasses(Module& M, const std::vector<StringRef>& names) {
+  legacy::PassManager pm;
+  PassRegistry& registry = *PassRegistry::getPassRegistry();
+  for (StringRef name: names) {
+    const PassInfo* info = registry.getPassInfo(name);
+    if (!info || !info->getNormalCtor()) {
+      errs() << "occam-slash: pass " << name << " is not registered\n";
+      return false;
+    }
+    pm.add(info->createPass());
+  }
+  return pm.run(M);
+}
+
+/* 
+ * Same as razor's optimize: opt -O3 -disable-simplify-libcalls
+ * --disable-loop-vectorization --disable-slp-vectorization
+ */
+static void optimizeModule(Module& M) {
+  PassManagerBuilder builder;
+  builder.OptLevel = 3;
+  builder.SizeLevel = 0;
+  builder.LoopVectorize = false;
+  builder.SLPVectorize = false;
+  if (!DisableInlining) {
+    builder.Inliner = createFunctionInliningPass(3, 0, false);
+  }
+  TargetLibraryInfoImpl* TLII =
+    new TargetLibraryInfoImpl(Triple(M.getTargetTriple()));
+  TLII->disableAllFunctions();
+  builder.LibraryInfo = TLII;
+
+  legacy::PassManager mpm;
+  mpm.add(new TargetLibraryInfoWrapperPass(*TLII));
+  legacy::FunctionPassManager fpm(&M);
+  builder.populateFunctionPassManager(fpm);
+  builder.populateModulePassManager(mpm);
+
+  fpm.doInitialization();
+  for (Function& F: M) {
+    fpm.run(F);
+  }
+  fpm.doFinalization();
+  mpm.run(M);
+}
+
+/* Force inlining of the definitions whose name starts with prefix */
+static bool forceInline(Module& M, StringRef prefix) {
+  SmallPtrSet<Function*, 8> ToInline;
+  for (auto &F: M) {
+    if (!F.isDeclaration() && F.getName().startswith(prefix)) {
+      ToInline.insert(&F);
+    }
+  }
+  if (ToInline.empty()) {
+    return false;
+  }
+  utils::inlineOnly(M, ToInline);
+  return true;
+}
+
+/* Same as razor's peval: intra-module specialization/optimization */
+static void partialEvaluate(Module& M, const SpecializeOptions& options) {
+  optimizeModule(M);
+
+  if (Devirtualize) {
+    runPasses(M, {"Pdevirt"});
+    if (InlineBounce) {
+      forceInline(M, "__occam.bounce");
+    }
+  }
+
+  if (IPDeadStoreElim) {
+    runPasses(M, {"lower-gv-init", "ip-dse", "Pipsccp", "dce", "globaldce"});
+  }
+
+  if (options.policy == SpecializationPolicyType::NOSPECIALIZE) {
+    // skipped intra-module specialization
+    return;
+  }
+
+  for (unsigned iteration = 1; ; ++iteration) {
+    if (iteration > 1 || IPDeadStoreElim) {
+      optimizeModule(M);
+    }
+    // same as Ppeval
+    CallGraph cg(M);
+    IntraSpecializeStats stats;
+    if (!SpecializeIntraComponent(M, cg, options, &stats)) {
+      break;
+    }
+    if (InlineSpec) {
+      forceInline(M, "__occam_spec.");
+    }
+    // Ppeval already cleaned up the functions that it changed
+    if (!stats.stopped && stats.clones + stats.callers <= ReoptimizeThreshold) {
+      errs() << "occam-slash: skipped whole-module optimization: only "
+	     << stats.clones + stats.callers << " functions changed\n";
+      break;
+    }
+  }
+}
+
+static std::vector<Module*> getProgram(SlashModules& modules) {
+  std::vector<Module*> program;
+  for (SlashModule& m: modules) {
+    program.push_back(m.module.get());
+  }
+  return program;
+}
+
+/* Compute the interface of each module wrt all its non-internal functions */
+static void computeReferences(SlashModules& modules) {
+  for (SlashModule& m: modules) {
+    m.interface.reset(new ComponentInterface());
+    CallGraph cg(*m.module);
+    GatherInterface(*m.module, cg, nullptr, *m.interface);
+  }
+}
+
+/* Internalize each module wrt the interfaces of the other modules */
+static void internalizeModules(SlashModules& modules,
+			       const ComponentInterface& entries,
+			       const MinimizeOptions& options) {
+  for (unsigned i = 0, e = modules.size(); i < e; ++i) {
+    ComponentInterface others;
+    others.join(entries);
+    for (unsigned j = 0; j < e; ++j) {
+      if (i != j) {
+	others.join(*modules[j].interface);
+      }
+    }
+    MinimizeComponent(*modules[i].module, others, options);
+  }
+}
+
+/* Same as razor's deep: compute the interfaces across all modules */
+static void deepInterface(SlashModules& modules,
+			  const ComponentInterface& entries,
+			  ComponentInterface& out) {
+  GatherDeepInterface(getProgram(modules), entries, out);
+  // as -Pinterface does
+  if (unsigned maxCalls = getInterfaceMaxCalls()) {
+    out.compact(maxCalls);
+  }
+}
+
+static bool writeModule(const Module& M, StringRef filename) {
+  std::error_code ec;
+  raw_fd_ostream out(filename, ec, sys::fs::F_None);
+  if (ec) {
+    errs() << "occam-slash: cannot open " << filename << ": "
+	   << ec.message() << "\n";
+    return false;
+  }
+  WriteBitcodeToFile(&M, out);
+  return true;
+}
+
+static void dumpModules(const SlashModules& modules, unsigned iteration,
+			StringRef step) {
+  if (DumpDir == "") {
+    return;
+  }
+  for (const SlashModule& m: modules) {
+    SmallString<256> path(DumpDir);
+    sys::path::append(path, sys::path::stem(m.input) + "." +
+		      std::to_string(iteration) + "." + step + ".bc");
+    writeModule(*m.module, path);
+  }
+}
+
+/* 
+ * Same as razor's specialize for all the modules at once: the calls
+ * of all the modules are ranked together against the budget.
+ */
+static void specializeModules(SlashModules& modules,
+			      ComponentInterface& interface,
+			      const SpecializeOptions& options) {
+  std::vector<ComponentInterfaceTransform*> transforms;
+  std::vector<std::unique_ptr<CallGraph>> cgs;
+  std::vector<CallGraph*> cgPtrs;
+  for (SlashModule& m: modules) {
+    m.transform.reset(new ComponentInterfaceTransform(&interface));
+    transforms.push_back(m.transform.get());
+    cgs.emplace_back(new CallGraph(*m.module));
+    cgPtrs.push_back(cgs.back().get());
+  }
+  SpecializeComponents(getProgram(modules), transforms, cgPtrs, options,
+		       *options.sharedBudget);
+}
+
+/* The global fixpoint of razor's slash (steps 1-6) */
+static void slash(SlashModules& modules, const ComponentInterface& entries) {
+  const MinimizeOptions minimizeOpts = getMinimizeOptions();
+  SpecializeOptions specializeOpts = getSpecializeOptions();
+  SpecializeOptions pevalOpts = getPartialEvalOptions();
+
+  // 1. First compute the simple interfaces
+  computeReferences(modules);
+  // 2. And internalize everything that we can
+  internalizeModules(modules, entries, minimizeOpts);
+  dumpModules(modules, 0, "i");
+
+  // -- Ppeval and Pspecialize of all the modules draw from one budget
+  //    so that the best specializations of the program go first.
+  SpecializationBudget budget(getProgram(modules),
+			      pevalOpts.budget > 0 ? pevalOpts.budget : specializeOpts.budget);
+  pevalOpts.sharedBudget = &budget;
+  specializeOpts.sharedBudget = &budget;
+
+  bool progress = true;
+  unsigned iteration = 0;
+  while (progress) {
+    ++iteration;
+    if (iteration > MaxIterations) {
+      errs() << "Fixpoint took more than " << MaxIterations
+	     << ". Stopping fixpoint.\n";
+      break;
+    }
+    progress = false;
+
+    // 3. Intra-module partial evaluation
+    for (SlashModule& m: modules) {
+      partialEvaluate(*m.module, pevalOpts);
+    }
+    dumpModules(modules, iteration, "p");
+
+    // 4. Gather inter-module interfaces
+    ComponentInterface before;
+    deepInterface(modules, entries, before);
+
+    // 5. Inter-module specialization
+    specializeModules(modules, before, specializeOpts);
+    dumpModules(modules, iteration, "s");
+
+    // and rewrite each module wrt the rewrites of the other modules
+    for (unsigned i = 0, e = modules.size(); i < e; ++i) {
+      ComponentInterfaceTransform rewrites;
+      for (unsigned j = 0; j < e; ++j) {
+	if (i != j) {
+	  rewrites.join(*modules[j].transform);
+	}
+      }
+      if (rewrites.rewriteCount() > 0) {
+	progress |= TransformComponent(*modules[i].module, rewrites);
+      }
+    }
+    for (SlashModule& m: modules) {
+      m.transform.reset();
+    }
+    dumpModules(modules, iteration, "r");
+
+    // Aggressive internalization
+    computeReferences(modules);
+    internalizeModules(modules, entries, minimizeOpts);
+
+    // 6. Sealing: compute the interfaces again after new specialized
+    // functions and hide exported functions that are not referenced
+    // from outside the module.
+    ComponentInterface after;
+    deepInterface(modules, entries, after);
+    for (SlashModule& m: modules) {
+      MinimizeComponent(*m.module, after, minimizeOpts);
+    }
+    dumpModules(modules, iteration, "h");
+
+    errs() << "occam-slash: finished iteration " << iteration
+	   << (progress ? " (progress)" : " (no progress)") << "\n";
+  }
+}
+
+int main(int argc, char** argv) {
+  sys::PrintStackTraceOnErrorSignal(argv[0]);
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;
+
+  PassRegistry& registry = *PassRegistry::getPassRegistry();
+  initializeCore(registry);
+  initializeAnalysis(registry);
+  initializeTransformUtils(registry);
+  initializeScalarOpts(registry);
+  initializeIPO(registry);
+  initializeInstCombine(registry);
+  initializeTarget(registry);
+
+  cl::ParseCommandLineOptions(argc, argv,
+			      "occam-slash: in-process previrtualization of a program\n");
+
+  if (OutputFilenames.size() != InputFilenames.size()) {
+    errs() << "occam-slash: expected one -Pslash-output per input file\n";
+    return 1;
+  }
+
+  LLVMContext context;
+  SlashModules modules(InputFilenames.size());
+  for (unsigned i = 0, e = InputFilenames.size(); i < e; ++i) {
+    SMDiagnostic err;
+    modules[i].input = InputFilenames[i];
+    modules[i].output = OutputFilenames[i];
+    modules[i].module = parseIRFile(InputFilenames[i], err, context);
+    if (!modules[i].module) {
+      err.print(argv[0], errs());
+      return 1;
+    }
+  }
+
+  ComponentInterface entries;
+  for (const std::string& input: EntryInterfaces) {
+    errs() << "Reading file '" << input << "'...";
+    if (entries.readFromFile(input)) {
+      errs() << "success\n";
+    } else {
+      errs() << "failed\n";
+      return 1;
+    }
+  }
+
+  slash(modules, entries);
+
+  for (const SlashModule& m: modules) {
+    if (verifyModule(*m.module, &errs())) {
+      errs() << "occam-slash: " << m.input << " is broken after specialization\n";
+      return 1;
+    }
+    if (!writeModule(*m.module, m.output)) {
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -1,5 +1,6 @@
 #include "transforms/DevirtFunctions.hh"
 #include "analysis/ClassHierarchyAnalysis.hh"
+#include "analysis/ProfileCounts.h"
 #include "llvm/Pass.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Support/raw_ostream.h"
@@ -507,7 +508,18 @@ namespace transforms {
     Type * VoidPtrType = getVoidPtrType (M->getContext());
     Value * FArg = castTo (&*(F->arg_begin()), VoidPtrType, "", InsertPt);
     BasicBlock * tailBB = defaultBB;
-    for (const Function *FL : *Targets) {
+    // The last target is tested first so the most frequent targets go
+    // last.
+    std::vector<const Function*> order(Targets->begin(), Targets->end());
+    std::stable_sort(order.begin(), order.end(),
+		     [this](const Function *F1, const Function *F2) {
+		       auto it1 = m_target_counts.find(F1);
+		       auto it2 = m_target_counts.find(F2);
+		       uint64_t c1 = it1 == m_target_counts.end() ? 0 : it1->second;
+		       uint64_t c2 = it2 == m_target_counts.end() ? 0 : it2->second;
+		       return c1 < c2;
+		     });
+    for (const Function *FL : order) {
       // Cast the function pointer to an integer.  This can go in the entry
       // block.
       Value * TargetInt =
@@ -633,6 +645,15 @@ namespace transforms {
     // -- Visit all of the call instructions in this function and
     // -- record those that are indirect function calls.
     visit(M);
+
+    // -- Use the profile to test the most frequent targets first
+    m_target_counts.clear();
+    analysis::ProfileCounts profile(M);
+    if (profile.hasProfile()) {
+      for (auto I: m_worklist) {
+	profile.getCallTargets(*I, m_target_counts);
+      }
+    }
     
     // -- Now go through and transform all of the indirect calls that
     // -- we found that need transforming.
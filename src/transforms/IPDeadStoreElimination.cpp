@@ -154,6 +154,7 @@ public:
 
     errs() << "Started ip-dse ... \n";
     unsigned skipped_chains = 0;
+    bool change = false;
     
     // Worklist: collect all shadow.mem store instructions whose
     // pointer operand is a global variable.
@@ -359,6 +360,7 @@ public:
 	} 
       }
       
+      change = num_deleted > 0;
       errs() << "\tNumber of deleted stores " << num_deleted << "\n";
       errs() << "\tSkipped " << skipped_chains
 	     << " def-use chains because they were too long\n";
@@ -368,13 +370,16 @@ public:
     // Make sure that we remove all the shadow.mem functions
     errs() << "Removing shadow.mem functions ... \n";
     sea_dsa::StripShadowMemPass SSMP;
-    SSMP.runOnModule(M);
+    change |= SSMP.runOnModule(M);
     
-    return false;
+    return change;
   }
   
   virtual void getAnalysisUsage(AnalysisUsage &AU) const override {
-    AU.setPreservesAll ();
+    // The shadow.mem calls are removed so ShadowMemPass is not
+    // preserved: a later pass that requires it (e.g., -Pipsccp with
+    // -Pipsccp-shadow-mem) gets the calls added again.
+    AU.setPreservesCFG ();
     // This pass will instrument the code with shadow.mem calls
     AU.addRequired<sea_dsa::ShadowMemPass>();
     AU.addRequired<llvm::UnifyFunctionExitNodes>();      
@@ -26,6 +26,19 @@
 //   pass. This pass removes dead stores. So the hope is that it will
 //   remove a lowered initializer if it is actually dead. As a result,
 //   IPSCCP can be more precise.
+// - With -Pipsccp-ranges, overdefined integer values (including
+//   arguments, return values and tracked globals) also carry the
+//   ConstantRange of the values they may take. Comparisons that the
+//   ranges decide are folded and switch cases outside the range of
+//   the condition are treated as infeasible.
+// - The fields of internal aggregate globals (e.g., configuration
+//   structs and option tables) are tracked separately if the global is
+//   only accessed through GEPs with constant indices.
+// - With -Pipsccp-shadow-mem, loads and stores of internal scalar
+//   globals that sea-dsa proves to be singleton regions follow the
+//   memory SSA form built by its ShadowMem pass, also across calls.
+//   Thus, a load of such a global gets the last value stored into it
+//   rather than the merge of all the stored values.
 //===----------------------------------------------------------------------===//
 
 
@@ -33,6 +46,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/PointerIntPair.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/DenseSet.h"
@@ -42,22 +56,32 @@
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/IR/CallSite.h"
+#include "llvm/IR/ConstantRange.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/Operator.h"
 #include "llvm/IR/OptBisect.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/SCCP.h"
 #include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/UnifyFunctionExitNodes.h"
+
+#include "analysis/MemorySSA.h"
+#include "sea_dsa/ShadowMem.hh"
 
 #include <algorithm>
+#include <map>
 
 using namespace llvm;
 
@@ -67,6 +91,34 @@ STATISTIC(IPNumDeadBlocks , "Number of basic blocks unreachable by IPSCCP");
 STATISTIC(IPNumInstRemoved, "Number of instructions removed by IPSCCP");
 STATISTIC(IPNumArgsElimed , "Number of arguments constant propagated by IPSCCP");
 STATISTIC(IPNumGlobalConst, "Number of globals found to be constant by IPSCCP");
+STATISTIC(IPNumCasesRemoved, "Number of switch cases removed by IPSCCP");
+STATISTIC(IPNumFieldsTracked, "Number of fields of aggregate globals tracked by IPSCCP");
+STATISTIC(IPNumUndefRounds, "Number of rounds of undef resolution by IPSCCP");
+STATISTIC(IPNumUndefScans, "Number of functions scanned for undefs by IPSCCP");
+STATISTIC(IPSolveMSecs, "Milliseconds spent solving by IPSCCP");
+STATISTIC(IPUndefMSecs, "Milliseconds spent scanning for undefs by IPSCCP");
+
+static llvm::cl::opt<bool>
+TrackRanges("Pipsccp-ranges",
+    llvm::cl::desc("IPSCCP: keep track of the range of overdefined integer "
+                   "values to fold comparisons and switch cases"),
+    llvm::cl::init(false));
+
+// The shadow.mem annotations are removed by -ip-dse but, since it does
+// not preserve sea-dsa's ShadowMem pass, they are added again for
+// -Pipsccp when it runs after -ip-dse in the same pass pipeline.
+static llvm::cl::opt<bool>
+UseShadowMem("Pipsccp-shadow-mem",
+    llvm::cl::desc("IPSCCP: follow the memory SSA form built by sea-dsa "
+                   "to propagate constants through singleton globals"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<unsigned>
+RangeWideningLimit("Pipsccp-ranges-widening",
+    llvm::cl::desc("IPSCCP: number of times the range of a value can grow "
+                   "before it is widened to the full set"),
+    llvm::cl::Hidden,
+    llvm::cl::init(8));
 
 #define SCCP_LOG(...) DEBUG(__VA_ARGS__)
 //#define SCCP_LOG(...) __VA_ARGS__
@@ -169,6 +221,20 @@ namespace transforms {
 	return nullptr;
       }
 
+      /// mergeIn - Merge V into this value. Return true if this is a change
+      /// in status.
+      bool mergeIn(LatticeVal V) {
+	if (isOverdefined() || V.isUnknown())
+	  return false;
+	if (V.isOverdefined())
+	  return markOverdefined();
+	if (isUnknown())
+	  return markConstant(V.getConstant());
+	if (getConstant() != V.getConstant())
+	  return markOverdefined();
+	return false;
+      }
+
       void markForcedConstant(Constant *V) {
 	assert(isUnknown() && "Can't force a defined value!");
 	Val.setInt(forcedconstant);
@@ -214,9 +280,76 @@ namespace transforms {
       /// GlobalValue - If we are tracking any values for the contents of a global
       /// variable, we keep a mapping from the constant accessor to the element of
       /// the global, to the currently known value.  If the value becomes
-      /// overdefined, it's entry is simply removed from this map.
+      /// overdefined, it's entry is simply removed from this map unless the
+      /// range of the global is tracked.
       DenseMap<GlobalVariable*, LatticeVal> TrackedGlobals;
 
+      /// TrackedField - The known value of a field of an aggregate
+      /// global together with the loads that read it.
+      struct TrackedField {
+        Type *Ty;                      // type of the field
+        SmallVector<unsigned, 4> Path; // indices of the field in the global
+        LatticeVal Val;
+        SmallVector<LoadInst*, 4> Loads;
+      };
+
+      /// TrackedAggregates - The tracked fields of aggregate globals that
+      /// are only accessed through GEPs with constant indices, keyed by
+      /// their byte offset.
+      DenseMap<GlobalVariable*, std::map<uint64_t, TrackedField>>
+        TrackedAggregates;
+
+      /// FieldPointers - The field that each GEP on a tracked aggregate
+      /// global points to.
+      DenseMap<Value*, TrackedField*> FieldPointers;
+
+      /// MemParam - A memory region passed to a function, identified by
+      /// the function and the index of the region.
+      typedef std::pair<Function*, unsigned> MemParam;
+
+      /// MemState - The content of each version of the regions of
+      /// internal scalar globals in the memory SSA form built by sea-dsa
+      /// (see analysis/MemorySSA.h). A version is the result of a
+      /// shadow.mem.store, shadow.mem.arg.init, shadow.mem.arg.mod,
+      /// shadow.mem.arg.ref_mod or shadow.mem.arg.new call, or a PHI node
+      /// of versions. Versions without an entry may have any content.
+      DenseMap<Value*, LatticeVal> MemState;
+      SmallVector<Value*, 64> MemWorkList;
+
+      /// MemLoads/MemStores - The version read by each load and defined by
+      /// each store of a tracked region. ShadowLoads - The load that each
+      /// shadow.mem.load call annotates.
+      DenseMap<LoadInst*, Value*> MemLoads;
+      DenseMap<StoreInst*, Value*> MemStores;
+      DenseMap<Instruction*, LoadInst*> ShadowLoads;
+
+      /// MemActuals - The formal region that each shadow.mem.arg.* call
+      /// passes its version to.
+      DenseMap<Instruction*, MemParam> MemActuals;
+
+      /// MemFormalIns/MemFormalOuts - The version of a formal region at
+      /// the entry and at the exit of its function. A formal region is
+      /// only in MemFormalIns if all the call sites pass it.
+      DenseMap<MemParam, Value*> MemFormalIns;
+      DenseMap<MemParam, Value*> MemFormalOuts;
+
+      /// MemOutActuals - The shadow.mem.arg.* calls that define the
+      /// version of the caller from each formal region at exit.
+      DenseMap<MemParam, SmallVector<Instruction*, 4>> MemOutActuals;
+
+      /// TrackRanges - Whether overdefined integer values carry a range.
+      bool TrackRanges;
+
+      /// RangeState - The range of the overdefined integer values. The
+      /// range of a return value is kept under its function and the
+      /// range of a tracked global under the global. An overdefined
+      /// value without an entry may take any value of its type.
+      struct ValueRange {
+        ConstantRange Range;
+        unsigned Widenings; // number of times Range has grown
+      };
+      DenseMap<Value*, ValueRange> RangeState;
+
       /// TrackedRetVals - If we are tracking arguments into and the return
       /// value out of a function, it will have an entry in this map, indicating
       /// what the known return value for the function is.
@@ -248,14 +381,21 @@ namespace transforms {
 
       SmallVector<BasicBlock*, 64>  BBWorkList;  // The BasicBlock work list
 
+      /// UnresolvedFunctions - The functions with a block or an
+      /// instruction visited since ResolvedUndefsIn was last called on
+      /// them. The other functions cannot have new undefs to resolve.
+      SetVector<Function*> UnresolvedFunctions;
+      Function *LastUnresolved = nullptr; // last function inserted
+
       /// KnownFeasibleEdges - Entries in this set are edges which have already had
       /// PHI nodes retriggered.
       typedef std::pair<BasicBlock*, BasicBlock*> Edge;
       DenseSet<Edge> KnownFeasibleEdges;
   
 public:
-  SCCPSolver(const DataLayout &DL, const TargetLibraryInfo *tli)
-    : DL(DL), TLI(tli) {}
+  SCCPSolver(const DataLayout &DL, const TargetLibraryInfo *tli,
+             bool TrackRanges = false)
+    : DL(DL), TLI(tli), TrackRanges(TrackRanges) {}
 
   /// MarkBlockExecutable - This method can be used by clients to mark all of
   /// the blocks that are known to be intrinsically live in the processed unit.
@@ -266,6 +406,7 @@ public:
       return false;
     SCCP_LOG(errs() << "Marking Block Executable: " << BB->getName() << '\n');
     BBWorkList.push_back(BB);  // Add the block to the work list!
+    markUnresolved(BB->getParent());
     return true;
   }
 
@@ -291,6 +432,81 @@ public:
     // }
   }
 
+  /// TrackFieldsOfGlobalVariable - inform the SCCPSolver that it
+  /// should track the fields of the aggregate global variable GV. This
+  /// is only possible if GV is only loaded and stored through GEPs with
+  /// constant indices or stored as a whole with a constant (e.g., by
+  /// LowerGvInitializers). Return true if the fields of GV are tracked.
+  bool TrackFieldsOfGlobalVariable(GlobalVariable *GV) {
+    if (!GV->getValueType()->isAggregateType())
+      return false;
+
+    std::map<uint64_t, TrackedField> Fields;
+    SmallVector<std::pair<Value*, uint64_t>, 16> Pointers;
+    bool InitializerIsStored = false;
+    for (User *U : GV->users()) {
+      if (auto *SI = dyn_cast<StoreInst>(U)) {
+        if (SI->getPointerOperand() != GV || SI->isVolatile() ||
+            !isa<Constant>(SI->getValueOperand()))
+          return false;
+        InitializerIsStored = true;
+        continue;
+      }
+
+      auto *GEP = dyn_cast<GEPOperator>(U);
+      if (!GEP || GEP->getPointerOperand() != GV)
+        return false;
+      uint64_t Offset;
+      TrackedField Field;
+      if (!getFieldOfGEP(*GEP, GV->getValueType(), Offset, Field))
+        return false;
+
+      for (User *GU : GEP->users()) {
+        if (auto *LI = dyn_cast<LoadInst>(GU)) {
+          if (LI->isVolatile() || LI->getType() != Field.Ty)
+            return false;
+          Field.Loads.push_back(LI);
+        } else if (auto *SI = dyn_cast<StoreInst>(GU)) {
+          if (SI->getPointerOperand() != GEP || SI->isVolatile() ||
+              SI->getValueOperand()->getType() != Field.Ty)
+            return false;
+        } else {
+          return false;
+        }
+      }
+
+      auto It = Fields.find(Offset);
+      if (It == Fields.end())
+        Fields.insert({Offset, std::move(Field)});
+      else if (It->second.Ty != Field.Ty)
+        return false;  // Overlapping fields.
+      else
+        It->second.Loads.append(Field.Loads.begin(), Field.Loads.end());
+      Pointers.push_back({GEP, Offset});
+    }
+
+    // As for scalar globals, the initializer is ignored if
+    // LowerGvInitializers has made it an explicit store. Otherwise, it
+    // is the value of the fields until they are stored.
+    if (!InitializerIsStored) {
+      for (auto &KV : Fields) {
+        TrackedField &Field = KV.second;
+        Constant *C = getFieldOfConstant(GV->getInitializer(), Field.Path);
+        if (!C)
+          Field.Val.markOverdefined();
+        else if (!isa<UndefValue>(C))
+          Field.Val.markConstant(C);
+      }
+    }
+
+    IPNumFieldsTracked += Fields.size();
+    std::map<uint64_t, TrackedField> &Tracked = TrackedAggregates[GV];
+    Tracked = std::move(Fields);
+    for (auto &P : Pointers)
+      FieldPointers[P.first] = &Tracked[P.second];
+    return true;
+  }
+
   /// AddTrackedFunction - If the SCCP solver is supposed to track calls into
   /// and out of the specified function (which cannot have its address taken),
   /// this method must be called.
@@ -309,10 +525,36 @@ public:
     TrackingIncomingArguments.insert(F);
   }
 
+  /// TrackShadowMem - inform the SCCPSolver that it should follow the
+  /// memory SSA form of M built by sea-dsa's ShadowMem pass through the
+  /// singleton regions of internal scalar globals. This must be called
+  /// after AddArgumentTrackedFunction. Return false if M has no
+  /// shadow.mem calls.
+  bool TrackShadowMem(Module &M);
+
   /// Solve - Solve for constants and executable blocks.
   ///
   void Solve();
 
+  /// ResolvedUndefsInChanged - Call ResolvedUndefsIn on the functions
+  /// visited by the solver since their last call. Return true if an
+  /// undef was resolved, in which case the solver should be rerun.
+  bool ResolvedUndefsInChanged() {
+    SetVector<Function*> Worklist;
+    std::swap(Worklist, UnresolvedFunctions);
+    LastUnresolved = nullptr;
+    bool Resolved = false;
+    for (Function *F : Worklist) {
+      ++IPNumUndefScans;
+      // Only one undef is resolved at a time so F may have more.
+      if (ResolvedUndefsIn(*F)) {
+        markUnresolved(F);
+        Resolved = true;
+      }
+    }
+    return Resolved;
+  }
+
   /// ResolvedUndefsIn - While solving the dataflow for a function, we assume
   /// that branches on undef values cannot reach any of their successors.
   /// However, this is not a safe assumption.  After we solve dataflow, this
@@ -354,6 +596,20 @@ public:
     return TrackedGlobals;
   }
 
+  /// getConstantAggregates - Get the aggregate globals whose tracked
+  /// fields were all found to be constant.
+  SmallVector<GlobalVariable*, 8> getConstantAggregates() const {
+    SmallVector<GlobalVariable*, 8> Res;
+    for (auto &KV : TrackedAggregates) {
+      if (std::none_of(KV.second.begin(), KV.second.end(),
+                       [](const std::pair<const uint64_t, TrackedField> &F) {
+                         return F.second.Val.isOverdefined();
+                       }))
+        Res.push_back(KV.first);
+    }
+    return Res;
+  }
+
   /// getMRVFunctionsTracked - Get the set of functions which return multiple
   /// values tracked by the pass.
   const SmallPtrSet<Function *, 16> getMRVFunctionsTracked() {
@@ -414,10 +670,127 @@ public:
       }      
       o << "\tret_val(" << kv.first->getName() << ")  --> " << kv.second << "\n";
     }
+    o << "TrackedFields\n";
+    for(auto& kv: TrackedAggregates) {
+      for(auto& f: kv.second) {
+	if (!f.second.Val.isConstant()) {
+	  continue;
+	}
+	o << "\t" << kv.first->getName() << "+" << f.first << " --> "
+	  << f.second.Val << "\n";
+      }
+    }
+    o << "RangeState\n";
+    for(auto& kv: RangeState) {
+      if (!kv.first->hasName()) {
+	continue;
+      }
+      o << "\t" << kv.first->getName() << " --> " << kv.second.Range << "\n";
+    }
     // TODO: print TrackedMultipleRetVals
   }
       
 private:
+
+  /// getFieldOfGEP - If GEP points to a single-value field of an object
+  /// of type Ty through constant, in-bounds indices, fill the type and
+  /// the path of the field and return its byte offset in Offset.
+  bool getFieldOfGEP(GEPOperator &GEP, Type *Ty, uint64_t &Offset,
+                     TrackedField &Field) const {
+    if (GEP.getSourceElementType() != Ty || GEP.getNumIndices() < 2)
+      return false;
+    auto *Idx0 = dyn_cast<ConstantInt>(GEP.getOperand(1));
+    if (!Idx0 || !Idx0->isZero())
+      return false;
+
+    Offset = 0;
+    for (unsigned i = 2, e = GEP.getNumOperands(); i != e; ++i) {
+      auto *CI = dyn_cast<ConstantInt>(GEP.getOperand(i));
+      if (!CI || CI->getValue().getActiveBits() > 32)
+        return false;
+      unsigned Idx = CI->getZExtValue();
+      if (auto *STy = dyn_cast<StructType>(Ty)) {
+        Offset += DL.getStructLayout(STy)->getElementOffset(Idx);
+        Ty = STy->getElementType(Idx);
+      } else if (auto *ATy = dyn_cast<ArrayType>(Ty)) {
+        if (Idx >= ATy->getNumElements())
+          return false;
+        Ty = ATy->getElementType();
+        Offset += Idx * DL.getTypeAllocSize(Ty);
+      } else {
+        return false;
+      }
+      Field.Path.push_back(Idx);
+    }
+    Field.Ty = Ty;
+    return Ty->isSingleValueType();
+  }
+
+  /// getFieldOfConstant - Return the element of the aggregate constant
+  /// C at Path or null if it is not known.
+  static Constant *getFieldOfConstant(Constant *C, ArrayRef<unsigned> Path) {
+    for (unsigned Idx : Path) {
+      if (!C)
+        return nullptr;
+      C = C->getAggregateElement(Idx);
+    }
+    return C;
+  }
+
+  /// mergeInField - Merge MergeWithV into the value of Field and update
+  /// the loads of the field if it changed.
+  void mergeInField(TrackedField &Field, LatticeVal MergeWithV) {
+    if (Field.Val.mergeIn(MergeWithV))
+      for (LoadInst *LI : Field.Loads)
+        OperandChangedState(LI);
+  }
+
+  /// getMemState - Return the content of the memory region version V.
+  LatticeVal getMemState(Value *V) const {
+    LatticeVal LV;
+    auto It = V ? MemState.find(V) : MemState.end();
+    if (It != MemState.end())
+      return It->second;
+    if (!V || !isa<UndefValue>(V))
+      LV.markOverdefined();
+    return LV;
+  }
+
+  /// mergeInMem - Merge MergeWithV into the content of the memory
+  /// region version V and update the users of V if it changed.
+  void mergeInMem(Value *V, LatticeVal MergeWithV) {
+    auto It = MemState.find(V);
+    if (It != MemState.end() && It->second.mergeIn(MergeWithV))
+      MemWorkList.push_back(V);
+  }
+
+  /// getSingletonGlobal - Return the global of the region of the
+  /// shadow.mem call CS if it is an internal scalar global.
+  static GlobalVariable *getSingletonGlobal(ImmutableCallSite CS,
+                                            analysis::MemSSAOp Op) {
+    auto *GV = const_cast<GlobalVariable*>(dyn_cast_or_null<GlobalVariable>(
+      analysis::getMemSSASingleton(CS, Op)));
+    if (GV && GV->hasLocalLinkage() && GV->getValueType()->isSingleValueType())
+      return GV;
+    return nullptr;
+  }
+
+  /// getShadowMemCallee - Return the function called by the call site
+  /// that the shadow.mem.arg.* call I annotates, i.e., the next call in
+  /// its block. Invokes are not considered.
+  static Function *getShadowMemCallee(Instruction *I) {
+    for (I = I->getNextNode(); I; I = I->getNextNode()) {
+      CallSite CS(I);
+      if (!CS)
+        continue;
+      Function *F = CS.getCalledFunction();
+      if (F && F->getName().startswith("shadow.mem"))
+        continue;
+      return CS.isCall() ? F : nullptr;
+    }
+    return nullptr;
+  }
+
       
   // pushToWorkList - Helper for markConstant/markForcedConstant/markOverdefined
   void pushToWorkList(LatticeVal &IV, Value *V) {
@@ -456,7 +829,12 @@ private:
   // value is not already overdefined, add it to the overdefined instruction
   // work list so that the users of the instruction are updated later.
   void markOverdefined(LatticeVal &IV, Value *V) {
-    if (!IV.markOverdefined()) return;
+    if (!IV.markOverdefined()) {
+      // V may now take any value: drop the range it had.
+      if (!RangeState.empty() && RangeState.erase(V))
+        OverdefinedInstWorkList.push_back(V);
+      return;
+    }
 
     SCCP_LOG(errs() << "markOverdefined: ";
           if (auto *F = dyn_cast<Function>(V))
@@ -467,8 +845,86 @@ private:
     pushToWorkList(IV, V);
   }
 
-  void mergeInValue(LatticeVal &IV, Value *V, LatticeVal MergeWithV) {
-    if (IV.isOverdefined() || MergeWithV.isUnknown())
+  // markOverdefined - Make a value be marked as "overdefined" but
+  // remember that it can only take values in R. If the value is
+  // already overdefined, R is joined to its range and its users are
+  // updated if the range grew.
+  void markOverdefined(LatticeVal &IV, Value *V, ConstantRange R) {
+    if (!getRangeType(V) || R.isEmptySet())
+      return markOverdefined(IV, V);
+
+    if (!IV.isOverdefined()) {
+      if (IV.isConstant())
+        R = R.unionWith(getRange(V, IV, R.getBitWidth()));
+      if (!R.isFullSet())
+        RangeState.insert({V, {R, 0}});
+      return markOverdefined(IV, V);
+    }
+
+    auto It = RangeState.find(V);
+    if (It == RangeState.end())
+      return;  // V may already take any value.
+    ConstantRange NewR = It->second.Range.unionWith(R);
+    if (NewR == It->second.Range)
+      return;
+    // Widen ranges that keep growing (e.g., loop counters) so that
+    // the solver terminates quickly.
+    if (NewR.isFullSet() || ++It->second.Widenings > RangeWideningLimit)
+      RangeState.erase(It);
+    else
+      It->second.Range = NewR;
+    SCCP_LOG(errs() << "markRange: " << NewR << ": " << V->getName() << '\n');
+    OverdefinedInstWorkList.push_back(V);
+  }
+
+  /// getRangeType - Return the integer type of the values whose range
+  /// is kept under V or null if no range is tracked for V.
+  IntegerType *getRangeType(Value *V) const {
+    if (!TrackRanges)
+      return nullptr;
+    Type *Ty = V->getType();
+    if (auto *F = dyn_cast<Function>(V))
+      Ty = F->getReturnType();
+    else if (auto *GV = dyn_cast<GlobalVariable>(V))
+      Ty = GV->getValueType();
+    return dyn_cast<IntegerType>(Ty);
+  }
+
+  /// getRange - Return the range of values that V, whose lattice value
+  /// is LV, may take. V can be null if nothing is known about its range.
+  ConstantRange getRange(Value *V, LatticeVal LV, unsigned BitWidth) const {
+    if (LV.isUnknown())
+      return ConstantRange(BitWidth, /*isFullSet=*/false);
+    if (LV.isConstant()) {
+      if (ConstantInt *CI = LV.getConstantInt())
+        return ConstantRange(CI->getValue());
+      return ConstantRange(BitWidth, /*isFullSet=*/true);
+    }
+    if (V) {
+      auto It = RangeState.find(V);
+      if (It != RangeState.end())
+        return It->second.Range;
+    }
+    return ConstantRange(BitWidth, /*isFullSet=*/true);
+  }
+
+  // mergeInValue - Merge MergeWithV, the lattice value of From, into
+  // the lattice value IV of V. From is only needed to merge ranges.
+  void mergeInValue(LatticeVal &IV, Value *V, LatticeVal MergeWithV,
+                    Value *From = nullptr) {
+    if (MergeWithV.isUnknown())
+      return;  // Noop.
+    if (IntegerType *ITy = getRangeType(V)) {
+      if (IV.isUnknown() && MergeWithV.isConstant())
+        return markConstant(IV, V, MergeWithV.getConstant());
+      if (IV.isConstant() && MergeWithV.isConstant() &&
+          IV.getConstant() == MergeWithV.getConstant())
+        return;
+      // Otherwise V is overdefined but its range can still be refined.
+      return markOverdefined(IV, V,
+                             getRange(From, MergeWithV, ITy->getBitWidth()));
+    }
+    if (IV.isOverdefined())
       return;  // Noop.
     if (MergeWithV.isOverdefined())
       return markOverdefined(IV, V);
@@ -479,10 +935,10 @@ private:
     }
   }
 
-  void mergeInValue(Value *V, LatticeVal MergeWithV) {
+  void mergeInValue(Value *V, LatticeVal MergeWithV, Value *From = nullptr) {
     assert(!V->getType()->isStructTy() &&
            "non-structs should use markConstant");
-    mergeInValue(ValueState[V], V, MergeWithV);
+    mergeInValue(ValueState[V], V, MergeWithV, From);
   }
 
   /// getValueState - Return the LatticeVal object that corresponds to the
@@ -576,8 +1032,18 @@ private:
   // information, we need to update the specified user of this instruction.
   //
   void OperandChangedState(Instruction *I) {
-    if (BBExecutable.count(I->getParent()))   // Inst is executable?
+    if (BBExecutable.count(I->getParent())) { // Inst is executable?
+      markUnresolved(I->getFunction());
       visit(*I);
+    }
+  }
+
+  // markUnresolved - F may have new undefs to resolve.
+  void markUnresolved(Function *F) {
+    if (F == LastUnresolved)
+      return;
+    UnresolvedFunctions.insert(F);
+    LastUnresolved = F;
   }
 
 private:
@@ -587,6 +1053,7 @@ private:
   // operand made a transition, or the instruction is newly executable.  Change
   // the value type of I to reflect these changes if appropriate.
   void visitPHINode(PHINode &I);
+  void markPHIOverdefined(PHINode &PN);
 
   // Terminators
   void visitReturnInst(ReturnInst &I);
@@ -595,6 +1062,8 @@ private:
   void visitCastInst(CastInst &I);
   void visitSelectInst(SelectInst &I);
   void visitBinaryOperator(Instruction &I);
+  ConstantRange getBinaryOpRange(Instruction &I, LatticeVal V1State,
+                                 LatticeVal V2State) const;
   void visitCmpInst(CmpInst &I);
   void visitExtractValueInst(ExtractValueInst &EVI);
   void visitInsertValueInst(InsertValueInst &IVI);
@@ -615,6 +1084,7 @@ private:
     visitTerminatorInst(II);
   }
   void visitCallSite      (CallSite CS);
+  void visitShadowMemCall (CallSite CS);
   void visitResumeInst    (TerminatorInst &I) { /*returns void*/ }
   void visitUnreachableInst(TerminatorInst &I) { /*returns void*/ }
   void visitFenceInst     (FenceInst &I) { /*returns void*/ }
@@ -668,9 +1138,22 @@ void SCCPSolver::getFeasibleSuccessors(TerminatorInst &TI,
     ConstantInt *CI = SCValue.getConstantInt();
 
     if (!CI) {   // Overdefined or unknown condition?
-      // All destinations are executable!
-      if (!SCValue.isUnknown())
+      if (SCValue.isUnknown())
+        return;
+      IntegerType *ITy = getRangeType(SI->getCondition());
+      if (!ITy || !SCValue.isOverdefined()) {
+        // All destinations are executable!
         Succs.assign(TI.getNumSuccessors(), true);
+        return;
+      }
+      // Only the default destination and the cases within the range of
+      // the condition are executable.
+      ConstantRange R = getRange(SI->getCondition(), SCValue,
+                                 ITy->getBitWidth());
+      Succs[0] = true;
+      for (auto Case : SI->cases())
+        if (R.contains(Case.getCaseValue()->getValue()))
+          Succs[Case.getSuccessorIndex()] = true;
       return;
     }
 
@@ -750,8 +1233,20 @@ bool SCCPSolver::isEdgeFeasible(BasicBlock *From, BasicBlock *To) {
     LatticeVal SCValue = getValueState(SI->getCondition());
     ConstantInt *CI = SCValue.getConstantInt();
 
-    if (!CI)
-      return !SCValue.isUnknown();
+    if (!CI) {
+      if (SCValue.isUnknown())
+        return false;
+      IntegerType *ITy = getRangeType(SI->getCondition());
+      if (!ITy || !SCValue.isOverdefined() || SI->getDefaultDest() == To)
+        return true;
+      ConstantRange R = getRange(SI->getCondition(), SCValue,
+                                 ITy->getBitWidth());
+      for (auto Case : SI->cases())
+        if (Case.getCaseSuccessor() == To &&
+            R.contains(Case.getCaseValue()->getValue()))
+          return true;
+      return false;
+    }
 
     return SI->findCaseValue(CI)->getCaseSuccessor() == To;
   }
@@ -792,19 +1287,31 @@ bool SCCPSolver::isEdgeFeasible(BasicBlock *From, BasicBlock *To) {
 //    successors executable.
 //
 void SCCPSolver::visitPHINode(PHINode &PN) {
+  // A PHI node of versions of a tracked region merges their content.
+  if (!MemState.empty() && MemState.count(&PN)) {
+    for (unsigned i = 0, e = PN.getNumIncomingValues(); i != e; ++i)
+      if (isEdgeFeasible(PN.getIncomingBlock(i), PN.getParent()))
+        mergeInMem(&PN, getMemState(PN.getIncomingValue(i)));
+    return markOverdefined(&PN);
+  }
+
   // If this PN returns a struct, just mark the result overdefined.
   // TODO: We could do a lot better than this if code actually uses this.
   if (PN.getType()->isStructTy())
     return markOverdefined(&PN);
 
-  if (getValueState(&PN).isOverdefined())
-    return;  // Quick exit
-
   // Super-extra-high-degree PHI nodes are unlikely to ever be marked constant,
   // and slow us down a lot.  Just mark them overdefined.
   if (PN.getNumIncomingValues() > 64)
     return markOverdefined(&PN);
 
+  if (getValueState(&PN).isOverdefined()) {
+    // The range of the PHI node can still grow.
+    if (getRangeType(&PN))
+      markPHIOverdefined(PN);
+    return;  // Quick exit
+  }
+
   // Look at all of the executable operands of the PHI node.  If any of them
   // are overdefined, the PHI becomes overdefined as well.  If they are all
   // constant, and they agree with each other, the PHI becomes the identical
@@ -820,7 +1327,7 @@ void SCCPSolver::visitPHINode(PHINode &PN) {
       continue;
 
     if (IV.isOverdefined())    // PHI node becomes overdefined!
-      return markOverdefined(&PN);
+      return markPHIOverdefined(PN);
 
     if (!OperandVal) {   // Grab the first value.
       OperandVal = IV.getConstant();
@@ -834,7 +1341,7 @@ void SCCPSolver::visitPHINode(PHINode &PN) {
     // Check to see if there are two different constants merging, if so, the PHI
     // node is overdefined.
     if (IV.getConstant() != OperandVal)
-      return markOverdefined(&PN);
+      return markPHIOverdefined(PN);
   }
 
   // If we exited the loop, this means that the PHI node only has constant
@@ -846,6 +1353,25 @@ void SCCPSolver::visitPHINode(PHINode &PN) {
     markConstant(&PN, OperandVal);      // Acquire operand value
 }
 
+// markPHIOverdefined - Mark PN overdefined. If ranges are tracked, its
+// range is the union of the ranges of its feasible incoming values.
+void SCCPSolver::markPHIOverdefined(PHINode &PN) {
+  IntegerType *ITy = getRangeType(&PN);
+  if (!ITy)
+    return markOverdefined(&PN);
+
+  ConstantRange R(ITy->getBitWidth(), /*isFullSet=*/false);
+  for (unsigned i = 0, e = PN.getNumIncomingValues(); i != e; ++i) {
+    Value *InVal = PN.getIncomingValue(i);
+    LatticeVal IV = getValueState(InVal);
+    if (IV.isUnknown() ||
+        !isEdgeFeasible(PN.getIncomingBlock(i), PN.getParent()))
+      continue;
+    R = R.unionWith(getRange(InVal, IV, ITy->getBitWidth()));
+  }
+  markOverdefined(ValueState[&PN], &PN, R);
+}
+
 void SCCPSolver::visitReturnInst(ReturnInst &I) {
   if (I.getNumOperands() == 0) return;  // ret void
 
@@ -857,7 +1383,7 @@ void SCCPSolver::visitReturnInst(ReturnInst &I) {
     DenseMap<Function*, LatticeVal>::iterator TFRVI =
       TrackedRetVals.find(F);
     if (TFRVI != TrackedRetVals.end()) {
-      mergeInValue(TFRVI->second, F, getValueState(ResultOp));
+      mergeInValue(TFRVI->second, F, getValueState(ResultOp), ResultOp);
       return;
     }
   }
@@ -887,9 +1413,16 @@ void SCCPSolver::visitTerminatorInst(TerminatorInst &TI) {
 
 void SCCPSolver::visitCastInst(CastInst &I) {
   LatticeVal OpSt = getValueState(I.getOperand(0));
-  if (OpSt.isOverdefined())          // Inherit overdefinedness of operand
-    markOverdefined(&I);
-  else if (OpSt.isConstant()) {
+  if (OpSt.isOverdefined()) {        // Inherit overdefinedness of operand
+    IntegerType *ITy = getRangeType(&I);
+    auto *OpTy = dyn_cast<IntegerType>(I.getOperand(0)->getType());
+    if (!ITy || !OpTy)
+      return markOverdefined(&I);
+    ConstantRange OpRange = getRange(I.getOperand(0), OpSt,
+                                     OpTy->getBitWidth());
+    markOverdefined(ValueState[&I], &I,
+                    OpRange.castOp(I.getOpcode(), ITy->getBitWidth()));
+  } else if (OpSt.isConstant()) {
     // Fold the constant as we build.
     Constant *C = ConstantFoldCastOperand(I.getOpcode(), OpSt.getConstant(),
                                           I.getType(), DL);
@@ -967,7 +1500,7 @@ void SCCPSolver::visitSelectInst(SelectInst &I) {
 
   if (ConstantInt *CondCB = CondValue.getConstantInt()) {
     Value *OpVal = CondCB->isZero() ? I.getFalseValue() : I.getTrueValue();
-    mergeInValue(&I, getValueState(OpVal));
+    mergeInValue(&I, getValueState(OpVal), OpVal);
     return;
   }
 
@@ -983,9 +1516,15 @@ void SCCPSolver::visitSelectInst(SelectInst &I) {
     return markConstant(&I, FVal.getConstant());
 
   if (TVal.isUnknown())   // select ?, undef, X -> X.
-    return mergeInValue(&I, FVal);
+    return mergeInValue(&I, FVal, I.getFalseValue());
   if (FVal.isUnknown())   // select ?, X, undef -> X.
-    return mergeInValue(&I, TVal);
+    return mergeInValue(&I, TVal, I.getTrueValue());
+  if (IntegerType *ITy = getRangeType(&I)) {
+    unsigned BW = ITy->getBitWidth();
+    ConstantRange R = getRange(I.getTrueValue(), TVal, BW)
+      .unionWith(getRange(I.getFalseValue(), FVal, BW));
+    return markOverdefined(ValueState[&I], &I, R);
+  }
   markOverdefined(&I);
 }
 
@@ -995,7 +1534,13 @@ void SCCPSolver::visitBinaryOperator(Instruction &I) {
   LatticeVal V2State = getValueState(I.getOperand(1));
 
   LatticeVal &IV = ValueState[&I];
-  if (IV.isOverdefined()) return;
+  if (IV.isOverdefined()) {
+    // The range of the result can still grow.
+    if (getRangeType(&I) &&
+        (V1State.isOverdefined() || V2State.isOverdefined()))
+      markOverdefined(IV, &I, getBinaryOpRange(I, V1State, V2State));
+    return;
+  }
 
   if (V1State.isConstant() && V2State.isConstant()) {
     Constant *C = ConstantExpr::get(I.getOpcode(), V1State.getConstant(),
@@ -1049,10 +1594,23 @@ void SCCPSolver::visitBinaryOperator(Instruction &I) {
     }
   }
 
-
+  if (getRangeType(&I))
+    return markOverdefined(IV, &I, getBinaryOpRange(I, V1State, V2State));
   markOverdefined(&I);
 }
 
+// getBinaryOpRange - Return the range of the integer binary operator I
+// given the lattice values of its operands.
+ConstantRange SCCPSolver::getBinaryOpRange(Instruction &I, LatticeVal V1State,
+                                           LatticeVal V2State) const {
+  unsigned BW = I.getType()->getIntegerBitWidth();
+  if (V1State.isUnknown() || V2State.isUnknown())
+    return ConstantRange(BW, /*isFullSet=*/true);
+  ConstantRange R1 = getRange(I.getOperand(0), V1State, BW);
+  ConstantRange R2 = getRange(I.getOperand(1), V2State, BW);
+  return R1.binaryOp(static_cast<Instruction::BinaryOps>(I.getOpcode()), R2);
+}
+
 // Handle ICmpInst instruction.
 void SCCPSolver::visitCmpInst(CmpInst &I) {
   LatticeVal V1State = getValueState(I.getOperand(0));
@@ -1073,6 +1631,20 @@ void SCCPSolver::visitCmpInst(CmpInst &I) {
   if (!V1State.isOverdefined() && !V2State.isOverdefined())
     return;
 
+  // The comparison might be decided by the ranges of its operands.
+  if (auto *ITy = dyn_cast<IntegerType>(I.getOperand(0)->getType()))
+    if (TrackRanges && !V1State.isUnknown() && !V2State.isUnknown()) {
+      unsigned BW = ITy->getBitWidth();
+      ConstantRange R1 = getRange(I.getOperand(0), V1State, BW);
+      ConstantRange R2 = getRange(I.getOperand(1), V2State, BW);
+      CmpInst::Predicate Pred = I.getPredicate();
+      if (ConstantRange::makeSatisfyingICmpRegion(Pred, R2).contains(R1))
+        return markConstant(IV, &I, ConstantInt::getTrue(I.getType()));
+      Pred = CmpInst::getInversePredicate(Pred);
+      if (ConstantRange::makeSatisfyingICmpRegion(Pred, R2).contains(R1))
+        return markConstant(IV, &I, ConstantInt::getFalse(I.getType()));
+    }
+
   markOverdefined(&I);
 }
 
@@ -1108,7 +1680,38 @@ void SCCPSolver::visitGetElementPtrInst(GetElementPtrInst &I) {
 
 void SCCPSolver::visitStoreInst(StoreInst &SI) {
   SCCP_LOG(errs() << "[SccpSolver]: Analyzing " << SI << "\n");
-  
+
+  // Stores to tracked regions define a new version.
+  if (!MemStores.empty()) {
+    auto MS = MemStores.find(&SI);
+    if (MS != MemStores.end())
+      mergeInMem(MS->second, getValueState(SI.getValueOperand()));
+  }
+
+  // Stores to the fields of tracked aggregate globals.
+  if (!FieldPointers.empty()) {
+    auto FP = FieldPointers.find(SI.getPointerOperand());
+    if (FP != FieldPointers.end())
+      return mergeInField(*FP->second, getValueState(SI.getValueOperand()));
+
+    auto *GV = dyn_cast<GlobalVariable>(SI.getPointerOperand());
+    auto TA = GV ? TrackedAggregates.find(GV) : TrackedAggregates.end();
+    if (TA != TrackedAggregates.end()) {
+      // A constant stored to the whole global.
+      Constant *C = cast<Constant>(SI.getValueOperand());
+      for (auto &KV : TA->second) {
+        LatticeVal EltVal;
+        Constant *Elt = getFieldOfConstant(C, KV.second.Path);
+        if (!Elt)
+          EltVal.markOverdefined();
+        else if (!isa<UndefValue>(Elt))
+          EltVal.markConstant(Elt);
+        mergeInField(KV.second, EltVal);
+      }
+      return;
+    }
+  }
+
   // If this store is of a struct, ignore it.
   if (SI.getValueOperand()->getType()->isStructTy())
     return;
@@ -1118,12 +1721,13 @@ void SCCPSolver::visitStoreInst(StoreInst &SI) {
     if (I == TrackedGlobals.end()) {
       return;
     }
-    if (I->second.isOverdefined()) {
+    if (I->second.isOverdefined() && !getRangeType(GV)) {
       return;
     }
     // Get the value we are storing into the global, then merge it.
-    mergeInValue(I->second, GV, getValueState(SI.getValueOperand()));
-    if (I->second.isOverdefined())
+    mergeInValue(I->second, GV, getValueState(SI.getValueOperand()),
+                 SI.getValueOperand());
+    if (I->second.isOverdefined() && !getRangeType(GV))
       TrackedGlobals.erase(I);      // No need to keep tracking this!
   }
 }
@@ -1138,6 +1742,25 @@ void SCCPSolver::visitLoadInst(LoadInst &I) {
   if (I.getType()->isStructTy())
     return markOverdefined(&I);
 
+  // Loads of the fields of tracked aggregate globals.
+  if (!FieldPointers.empty()) {
+    auto FP = FieldPointers.find(I.getPointerOperand());
+    if (FP != FieldPointers.end())
+      return mergeInValue(ValueState[&I], &I, FP->second->Val);
+  }
+
+  // Loads of tracked regions read the content of their version. If it
+  // is overdefined, the load may still be resolved as any other load of
+  // the global.
+  if (!MemLoads.empty()) {
+    auto ML = MemLoads.find(&I);
+    if (ML != MemLoads.end()) {
+      LatticeVal MemVal = getMemState(ML->second);
+      if (!MemVal.isOverdefined())
+        return mergeInValue(&I, MemVal);
+    }
+  }
+
   LatticeVal PtrVal = getValueState(I.getPointerOperand());
   if (PtrVal.isUnknown()) {
     return;   // The pointer is not resolved yet!
@@ -1145,6 +1768,13 @@ void SCCPSolver::visitLoadInst(LoadInst &I) {
 
   LatticeVal &IV = ValueState[&I];
   if (IV.isOverdefined()) {
+    // Only the range of a load from a tracked global can still grow.
+    if (getRangeType(&I) && PtrVal.isConstant())
+      if (auto *GV = dyn_cast<GlobalVariable>(PtrVal.getConstant())) {
+        auto It = TrackedGlobals.find(GV);
+        if (It != TrackedGlobals.end())
+          mergeInValue(IV, &I, It->second, GV);
+      }
     return;
   }
 
@@ -1165,7 +1795,7 @@ void SCCPSolver::visitLoadInst(LoadInst &I) {
       DenseMap<GlobalVariable*, LatticeVal>::iterator It =
         TrackedGlobals.find(GV);
       if (It != TrackedGlobals.end()) {
-        mergeInValue(IV, &I, It->second);
+        mergeInValue(IV, &I, It->second, GV);
         return;
       }      
     }
@@ -1187,6 +1817,11 @@ void SCCPSolver::visitCallSite(CallSite CS) {
   Function *F = CS.getCalledFunction();
   Instruction *I = CS.getInstruction();
 
+  // The shadow.mem calls propagate the content of the tracked regions
+  // but their results are overdefined.
+  if (F && F->isDeclaration() && !MemState.empty())
+    visitShadowMemCall(CS);
+
   // The common case is that we aren't tracking the callee, either because we
   // are not doing interprocedural analysis or the callee is indirect, or is
   // external.  Handle these cases first.
@@ -1253,7 +1888,7 @@ CallOverdefined:
           mergeInValue(getStructValueState(&*AI, i), &*AI, CallArg);
         }
       } else {
-        mergeInValue(&*AI, getValueState(*CAI));
+        mergeInValue(&*AI, getValueState(*CAI), *CAI);
       }
     }
   }
@@ -1274,14 +1909,187 @@ CallOverdefined:
       goto CallOverdefined;  // Not tracking this callee.
 
     // If so, propagate the return value of the callee into this call result.
-    mergeInValue(I, TFRVI->second);
+    mergeInValue(I, TFRVI->second, F);
+  }
+}
+
+void SCCPSolver::visitShadowMemCall(CallSite CS) {
+  using namespace analysis;
+  Instruction *I = CS.getInstruction();
+  MemSSAOp Op = MemSSAStrToOp(CS.getCalledFunction()->getName());
+  switch (Op) {
+  case MEM_SSA_LOAD: {
+    // The content of the version read by the load changed.
+    auto SL = ShadowLoads.find(I);
+    if (SL != ShadowLoads.end())
+      OperandChangedState(SL->second);
+    break;
+  }
+  case MEM_SSA_ARG_REF:
+  case MEM_SSA_ARG_MOD:
+  case MEM_SSA_ARG_REF_MOD:
+  case MEM_SSA_ARG_NEW: {
+    auto MA = MemActuals.find(I);
+    if (MA == MemActuals.end())
+      break;
+    // Pass the version of the caller to the callee ...
+    auto In = MemFormalIns.find(MA->second);
+    if (In != MemFormalIns.end())
+      mergeInMem(In->second, getMemState(CS.getArgument(1)));
+    // ... and get back the version at the exit of the callee.
+    if (Op != MEM_SSA_ARG_REF)
+      mergeInMem(I, getMemState(MemFormalOuts.lookup(MA->second)));
+    break;
+  }
+  case MEM_SSA_FUN_OUT: {
+    int64_t Idx = getMemSSAParamIdx(CS);
+    if (Idx < 0)
+      break;
+    auto OA = MemOutActuals.find(MemParam(I->getFunction(), Idx));
+    if (OA != MemOutActuals.end())
+      for (Instruction *Actual : OA->second)
+        OperandChangedState(Actual);
+    break;
+  }
+  default:
+    break;
   }
 }
 
+bool SCCPSolver::TrackShadowMem(Module &M) {
+  using namespace analysis;
+  DenseMap<MemParam, unsigned> NumActuals;
+  SmallVector<Instruction*, 16> ArgInits;
+  SmallVector<PHINode*, 16> PHIs;
+  bool HasShadowMem = false;
+
+  for (Function &F : M) {
+    for (Instruction &I : instructions(F)) {
+      if (auto *PN = dyn_cast<PHINode>(&I)) {
+        PHIs.push_back(PN);
+        continue;
+      }
+      auto *CI = dyn_cast<CallInst>(&I);
+      Function *Fn = CI ? CI->getCalledFunction() : nullptr;
+      if (!Fn)
+        continue;
+      MemSSAOp Op = MemSSAStrToOp(Fn->getName());
+      if (Op == NON_MEM_SSA)
+        continue;
+
+      HasShadowMem = true;
+      ImmutableCallSite CS(CI);
+      GlobalVariable *GV = getSingletonGlobal(CS, Op);
+      switch (Op) {
+      case MEM_SSA_LOAD:
+        // The annotated load must read the global as a whole.
+        if (auto *LI = dyn_cast_or_null<LoadInst>(CI->getNextNode()))
+          if (GV && LI->getPointerOperand() == GV && !LI->isVolatile()) {
+            MemLoads[LI] = CI->getArgOperand(1);
+            ShadowLoads[CI] = LI;
+          }
+        break;
+      case MEM_SSA_STORE:
+        if (!GV)
+          break;
+        MemState[CI];
+        if (auto *SI = dyn_cast_or_null<StoreInst>(CI->getNextNode()))
+          if (SI->getPointerOperand() == GV && !SI->isVolatile()) {
+            MemStores[SI] = CI;
+            break;
+          }
+        // Any other write (e.g., a memset) is not tracked.
+        MemState[CI].markOverdefined();
+        break;
+      case MEM_SSA_ARG_INIT:
+        if (GV) {
+          MemState[CI];
+          ArgInits.push_back(CI);
+        }
+        break;
+      case MEM_SSA_ARG_REF:
+      case MEM_SSA_ARG_MOD:
+      case MEM_SSA_ARG_REF_MOD:
+      case MEM_SSA_ARG_NEW: {
+        Function *Callee = getShadowMemCallee(CI);
+        int64_t Idx = getMemSSAParamIdx(CS);
+        bool Known = Callee && !Callee->isDeclaration() && Idx >= 0;
+        MemParam P(Callee, Idx);
+        if (Known) {
+          MemActuals[CI] = P;
+          ++NumActuals[P];
+        }
+        if (Op == MEM_SSA_ARG_REF || !GV)
+          break;
+        MemState[CI];
+        if (Known)
+          MemOutActuals[P].push_back(CI);
+        else
+          MemState[CI].markOverdefined();
+        break;
+      }
+      case MEM_SSA_FUN_IN:
+      case MEM_SSA_FUN_OUT: {
+        int64_t Idx = getMemSSAParamIdx(CS);
+        if (Idx < 0)
+          break;
+        auto &Formals = Op == MEM_SSA_FUN_IN ? MemFormalIns : MemFormalOuts;
+        auto Res = Formals.insert({MemParam(&F, Idx), CI->getArgOperand(1)});
+        if (!Res.second)
+          Res.first->second = nullptr; // Not unique: any content.
+        break;
+      }
+      default:
+        break;
+      }
+    }
+  }
+
+  // The version at the entry of a function is only known if the
+  // function is not called from outside and each of its call sites
+  // passes the region.
+  SmallVector<MemParam, 16> Unknown;
+  for (auto &KV : MemFormalIns) {
+    Function *F = KV.first.first;
+    auto *CI = dyn_cast_or_null<CallInst>(KV.second);
+    if (!CI || !isMemSSAArgInit(CI, true) || !MemState.count(CI) ||
+        !TrackingIncomingArguments.count(F) ||
+        NumActuals.lookup(KV.first) != F->getNumUses())
+      Unknown.push_back(KV.first);
+  }
+  for (MemParam &P : Unknown)
+    MemFormalIns.erase(P);
+
+  SmallPtrSet<Value*, 16> Entries;
+  for (auto &KV : MemFormalIns)
+    Entries.insert(KV.second);
+  for (Instruction *I : ArgInits)
+    if (!Entries.count(I))
+      MemState[I].markOverdefined();
+
+  // A PHI node of versions is a version too.
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (PHINode *PN : PHIs) {
+      if (MemState.count(PN))
+        continue;
+      for (Value *V : PN->incoming_values())
+        if (MemState.count(V)) {
+          MemState[PN];
+          Changed = true;
+          break;
+        }
+    }
+  }
+
+  return HasShadowMem;
+}
+
 void SCCPSolver::Solve() {
   // Process the work lists until they are empty!
   while (!BBWorkList.empty() || !InstWorkList.empty() ||
-         !OverdefinedInstWorkList.empty()) {
+         !OverdefinedInstWorkList.empty() || !MemWorkList.empty()) {
     // Process the overdefined instruction's work list first, which drives other
     // things to overdefined more quickly.
     while (!OverdefinedInstWorkList.empty()) {
@@ -1319,6 +2127,17 @@ void SCCPSolver::Solve() {
             OperandChangedState(UI);
     }
 
+    // Process the tracked regions whose content changed.
+    while (!MemWorkList.empty()) {
+      Value *V = MemWorkList.pop_back_val();
+
+      SCCP_LOG(errs() << "\nPopped off M-WL: " << *V << '\n');
+
+      for (User *U : V->users())
+        if (auto *UI = dyn_cast<Instruction>(U))
+          OperandChangedState(UI);
+    }
+
     // Process the basic block work list.
     while (!BBWorkList.empty()) {
       BasicBlock *BB = BBWorkList.back();
@@ -1725,7 +2544,7 @@ static void findReturnsToZap(Function &F,
 // Propagation algorithm, and return true if the function was
 // modified. 
 //
-static bool runIPSCCP(Module &M, SCCPSolver& Solver) {
+static bool runIPSCCP(Module &M, SCCPSolver& Solver, bool UseShadowMem) {
   // AddressTakenFunctions - This set keeps track of the address-taken functions
   // that are in the input.  As IPSCCP runs through and simplifies code,
   // functions that were address taken can end up losing their
@@ -1776,12 +2595,14 @@ static bool runIPSCCP(Module &M, SCCPSolver& Solver) {
   // taken'.  If they don't have their addresses taken, we can
   // propagate constants through them. 
   for (GlobalVariable &G : M.globals()) {
-    if (!G.isConstant() &&
-	G.hasLocalLinkage() &&      
-        G.hasDefinitiveInitializer() && 
-	!AddressIsTaken(&G)) {
+    bool Trackable = !G.isConstant() &&
+                     G.hasLocalLinkage() &&
+                     G.hasDefinitiveInitializer();
+    if (Trackable && !AddressIsTaken(&G)) {
       Solver.TrackValueOfGlobalVariable(&G);
       SCCP_LOG(errs() << "[Sccp]: " << G.getName() << " is tracked\n");
+    } else if (Trackable && Solver.TrackFieldsOfGlobalVariable(&G)) {
+      SCCP_LOG(errs() << "[Sccp]: fields of " << G.getName() << " are tracked\n");
     } else {
       SCCP_LOG(errs() << "[Sccp]: " << G.getName() << " NOT TRACKABLE because: \n";
 	       if (G.isConstant()) {
@@ -1800,18 +2621,27 @@ static bool runIPSCCP(Module &M, SCCPSolver& Solver) {
     }
   }
 
+  if (UseShadowMem && !Solver.TrackShadowMem(M))
+    errs() << "IPSCCP: no shadow.mem calls found\n";
+
   errs() << "IPSCCP resolution of undefs started.\n";    
-  // Solve for constants.
+  // Solve for constants. Each round only scans for undefs the
+  // functions that the solver visited since they were last scanned.
   bool ResolvedUndefs = true;
+  double SolveTime = 0.0, UndefTime = 0.0;
   while (ResolvedUndefs) {
+    double Start = TimeRecord::getCurrentTime().getWallTime();
     Solver.Solve();
+    double Solved = TimeRecord::getCurrentTime().getWallTime();
 
     SCCP_LOG(errs() << "RESOLVING UNDEFS\n");
-    ResolvedUndefs = false;
-    for (Function &F : M) {
-      ResolvedUndefs |= Solver.ResolvedUndefsIn(F);
-    }
+    ResolvedUndefs = Solver.ResolvedUndefsInChanged();
+    ++IPNumUndefRounds;
+    UndefTime += TimeRecord::getCurrentTime().getWallTime() - Solved;
+    SolveTime += Solved - Start;
   }
+  IPSolveMSecs += unsigned(SolveTime * 1000);
+  IPUndefMSecs += unsigned(UndefTime * 1000);
   errs() << "IPSCCP resolution of undefs finished.\n";    
 
   errs() << "IPSCCP analysis finished.\n";  
@@ -1887,6 +2717,21 @@ static bool runIPSCCP(Module &M, SCCPSolver& Solver) {
         // Ignore blockaddress users; BasicBlock's dtor will handle them.
         if (!I) continue;
 
+        // A switch on a non-constant value can only have lost the cases
+        // that are out of the range of its condition.
+        if (auto *SI = dyn_cast<SwitchInst>(I))
+          if (!isa<ConstantInt>(SI->getCondition())) {
+            for (auto It = SI->case_begin(); It != SI->case_end(); ) {
+              if (It->getCaseSuccessor() == DeadBB) {
+                It = SI->removeCase(It);
+                ++IPNumCasesRemoved;
+              } else {
+                ++It;
+              }
+            }
+            continue;
+          }
+
         bool Folded = ConstantFoldTerminator(I->getParent());
         assert(Folded &&
               "Expect TermInst on constantint or blockaddress to be folded");
@@ -1940,9 +2785,10 @@ static bool runIPSCCP(Module &M, SCCPSolver& Solver) {
          E = TG.end(); I != E; ++I) {
     
     GlobalVariable *GV = I->first;
-    
-    assert(!I->second.isOverdefined() &&
-           "Overdefined values should have been taken out of the map!");
+
+    // Overdefined globals are only left in the map to track their range.
+    if (I->second.isOverdefined())
+      continue;
     DEBUG(dbgs() << "Found that GV '" << GV->getName() << "' is constant!\n");
     
     #if 0
@@ -1997,6 +2843,37 @@ static bool runIPSCCP(Module &M, SCCPSolver& Solver) {
     }
     #endif 
   }
+
+  // If all the fields of an aggregate global are constant and all its
+  // loads were folded, we can delete the global and its stores.
+  for (GlobalVariable *GV : Solver.getConstantAggregates()) {
+    bool HasLoads = false;
+    SmallVector<Instruction*, 16> DeadInsts;
+    for (User *U : GV->users()) {
+      if (auto *SI = dyn_cast<StoreInst>(U)) {
+        DeadInsts.push_back(SI);
+        continue;
+      }
+      for (User *GU : U->users()) {
+        if (isa<LoadInst>(GU))
+          HasLoads = true;
+        else
+          DeadInsts.push_back(cast<Instruction>(GU));
+      }
+      if (auto *GEP = dyn_cast<GetElementPtrInst>(U))
+        DeadInsts.push_back(GEP);
+    }
+    if (HasLoads)
+      continue;
+
+    for (Instruction *I : DeadInsts)
+      I->eraseFromParent();
+    GV->removeDeadConstantUsers();
+    if (GV->use_empty()) {
+      M.getGlobalList().erase(GV);
+      ++IPNumGlobalConst;
+    }
+  }
   errs() << "IPSCCP constant folding transformation finished.\n";
   
   return MadeChanges;
@@ -2040,8 +2917,14 @@ public:
     DL = &M.getDataLayout();
     TLI = &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
 
-    SCCPSolver Solver(*DL, TLI);
-    return runIPSCCP(M, Solver);
+    SCCPSolver Solver(*DL, TLI, TrackRanges);
+    bool Changed = runIPSCCP(M, Solver, UseShadowMem);
+    if (UseShadowMem) {
+      // Remove the shadow.mem calls added by sea-dsa
+      sea_dsa::StripShadowMemPass SSMP;
+      Changed |= SSMP.runOnModule(M);
+    }
+    return Changed;
   }
 
   void getAnalysisUsage(AnalysisUsage &AU) const override {
@@ -2049,6 +2932,11 @@ public:
     AU.addRequired<TargetLibraryInfoWrapperPass>();
     AU.addRequired<CallGraphWrapperPass>();
     AU.addRequired<DominatorTreeWrapperPass>();
+    if (UseShadowMem) {
+      // This pass will instrument the code with shadow.mem calls
+      AU.addRequired<sea_dsa::ShadowMemPass>();
+      AU.addRequired<UnifyFunctionExitNodes>();
+    }
   }
   
   StringRef getPassName() const override
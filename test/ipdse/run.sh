@@ -1,10 +1,10 @@
 #!/bin/bash
 
 usage () {
-    echo "Usage: $0 prog.c"
+    echo "Usage: $0 prog.c [opt options]"
 }
 
-if [ $# -ne 1 ]
+if [ $# -lt 1 ]
 then
     usage 
     exit 1
@@ -36,6 +36,9 @@ extension="${filename##*.}"
 filename="${filename%.*}"
 
 
+# The other arguments are options of -Pipsccp (e.g., -Pipsccp-ranges)
+OPTIONS="${@:2}"
+
 IN=$1
 OUT=$dirpath/$filename.bc
 echo "$CLANG -c -emit-llvm -O0 -Xclang -disable-O0-optnone $IN -o $OUT"
@@ -49,6 +52,6 @@ IN=$OUT
 
 # IN=$OUT
 OUT=$dirpath/$filename.o.bc
-echo "$OPT $LIBS -ip-dse -globaldce -Pipsccp -dce -globaldce $IN -o $OUT"
-$OPT $LIBS -ip-dse -globaldce -Pipsccp -dce -globaldce $IN -o $OUT
+echo "$OPT $LIBS -ip-dse -globaldce -Pipsccp $OPTIONS -dce -globaldce $IN -o $OUT"
+$OPT $LIBS -ip-dse -globaldce -Pipsccp $OPTIONS -dce -globaldce $IN -o $OUT
 $DIS $OUT -o $1.output # for lit
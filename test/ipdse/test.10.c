@@ -0,0 +1,29 @@
+// RUN: %cmd "%s" -Pipsccp-shadow-mem
+// RUN: cat "%s".output 2>&1  | FileCheck  "%s"
+// CHECK-NOT: You should not see this message
+
+#include <stdio.h>
+
+static int x;   // DEAD INITIALIZATION
+
+static void set(void) {
+  x = 2;    // LIVE STORE
+}
+
+int main(int argc, char* argv[]) {
+  // x is 1 or 2 so the loads of x are only folded by following the
+  // shadow.mem def-use chains from each load to the last store.
+  x = 1;    // LIVE STORE
+
+  if (x != 1) {
+    printf("1. You should not see this message\n");
+  }
+
+  set();
+
+  if (x != 2) {
+    printf("2. You should not see this message\n");
+  }
+
+  return 0;
+}
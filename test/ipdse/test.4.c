@@ -0,0 +1,32 @@
+// RUN: %cmd "%s" -Pipsccp-ranges
+// RUN: cat "%s".output 2>&1  | FileCheck  "%s"
+// CHECK-NOT: You should not see this message
+
+#include <stdio.h>
+
+extern int nd_int(void);
+
+static int mode;   // DEAD INITIALIZATION
+
+int main(int argc, char* argv[]) {
+  if (nd_int()) {
+    mode = 1;  // LIVE STORE
+  } else {
+    mode = 2;  // LIVE STORE
+  }
+
+  // mode is overdefined but in the range [1,3)
+  if (mode > 3) {
+    printf("1. You should not see this message\n");
+  }
+
+  if (mode < 1) {
+    printf("2. You should not see this message\n");
+  }
+
+  if (mode == 2) {
+    printf("3. You should see this message\n");
+  }
+
+  return 0;
+}
@@ -0,0 +1,33 @@
+// RUN: %cmd "%s" -Pipsccp-ranges
+// RUN: cat "%s".output 2>&1  | FileCheck  "%s"
+// CHECK-NOT: You should not see this message
+// CHECK-NOT: i32 7, label
+
+#include <stdio.h>
+
+extern int nd_int(void);
+
+static int mode;   // DEAD INITIALIZATION
+
+int main(int argc, char* argv[]) {
+  if (nd_int()) {
+    mode = 1;  // LIVE STORE
+  } else {
+    mode = 2;  // LIVE STORE
+  }
+
+  // case 7 is outside the range [1,3) of mode and is dropped
+  switch (mode) {
+  case 1:
+    printf("1. You should see this message\n");
+    break;
+  case 2:
+    printf("2. You should see this message\n");
+    break;
+  case 7:
+    printf("3. You should not see this message\n");
+    break;
+  }
+
+  return 0;
+}
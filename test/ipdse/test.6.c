@@ -0,0 +1,26 @@
+// RUN: %cmd "%s" -Pipsccp-ranges
+// RUN: cat "%s".output 2>&1  | FileCheck  "%s"
+// CHECK: You should see this message
+
+#include <stdio.h>
+
+extern int nd_int(void);
+
+static int counter;   // DEAD INITIALIZATION
+
+int main(int argc, char* argv[]) {
+  // The range of counter grows at each visit of the loop until it is
+  // widened to the full set: the solver terminates and does not fold
+  // the test below with a range that is too small.
+  for (counter = 0; counter < 100; counter++) {   // LIVE STORES
+    if (nd_int()) {
+      break;
+    }
+  }
+
+  if (counter == 50) {
+    printf("1. You should see this message\n");
+  }
+
+  return 0;
+}
@@ -0,0 +1,39 @@
+// RUN: %cmd "%s"
+// RUN: cat "%s".output 2>&1  | FileCheck  "%s"
+// RUN: cat "%s".output 2>&1  | FileCheck --check-prefix=GLOBAL "%s"
+// CHECK-NOT: You should not see this message
+// GLOBAL-NOT: @cfg
+
+#include <stdio.h>
+
+struct config {
+  int verbose;
+  int level;
+  char mode;
+};
+
+// Only accessed field by field: every field is constant, so the loads
+// are folded and cfg is removed with its stores.
+static struct config cfg = { 0, 3, 'a' };
+
+void init(void) {
+  cfg.level = 3;
+}
+
+int main(int argc, char* argv[]) {
+  init();
+
+  if (cfg.verbose) {
+    printf("1. You should not see this message\n");
+  }
+
+  if (cfg.level != 3) {
+    printf("2. You should not see this message\n");
+  }
+
+  if (cfg.mode != 'a') {
+    printf("3. You should not see this message\n");
+  }
+
+  return 0;
+}
@@ -0,0 +1,28 @@
+// RUN: %cmd "%s"
+// RUN: cat "%s".output 2>&1  | FileCheck  "%s"
+// RUN: cat "%s".output 2>&1  | FileCheck --check-prefix=GLOBAL "%s"
+// CHECK: You should see this message
+// GLOBAL: @cfg = internal global
+
+#include <stdio.h>
+
+extern void use(int*);
+
+struct config {
+  int verbose;
+  int level;
+};
+
+// The address of a field escapes: cfg cannot be tracked since use may
+// write any of its fields.
+static struct config cfg = { 0, 3 };
+
+int main(int argc, char* argv[]) {
+  use(&cfg.level);
+
+  if (cfg.verbose) {
+    printf("1. You should see this message\n");
+  }
+
+  return 0;
+}
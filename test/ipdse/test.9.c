@@ -0,0 +1,33 @@
+// RUN: %cmd "%s"
+// RUN: cat "%s".output 2>&1  | FileCheck  "%s"
+// RUN: cat "%s".output 2>&1  | FileCheck --check-prefix=GLOBAL "%s"
+// CHECK-NOT: You should not see this message
+// CHECK: You should see this message
+// GLOBAL: @cfg = internal global
+
+#include <stdio.h>
+
+extern int nd_int(void);
+
+struct config {
+  int verbose;
+  int level;
+};
+
+// verbose is folded but level is not constant: its load remains, so
+// cfg must not be removed.
+static struct config cfg = { 0, 3 };
+
+int main(int argc, char* argv[]) {
+  cfg.level = nd_int();
+
+  if (cfg.verbose) {
+    printf("1. You should not see this message\n");
+  }
+
+  if (cfg.level == 5) {
+    printf("2. You should see this message\n");
+  }
+
+  return 0;
+}
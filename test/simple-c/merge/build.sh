@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+
+# Build the manifest file
+cat > merge.manifest <<EOF
+{ "main" : "main.o.bc"
+, "binary"  : "main"
+, "modules"    : ["scale.o.bc"]
+, "native_libs" : []
+, "ldflags"  : []
+, "name"    : "main"
+}
+EOF
+
+#make the bitcode
+make
+
+export OCCAM_LOGLEVEL=INFO
+export OCCAM_LOGFILE=${PWD}/slash/occam.log
+export PATH=${LLVM_HOME}/bin:${PATH}
+
+slash --intra-spec-policy=nonrec-aggressive --inter-spec-policy=aggressive \
+      --no-strip --work-dir=slash merge.manifest
+
+cp slash/main main_slash
+
+#debugging stuff below:
+for bitcode in slash/*.bc; do
+    ${LLVM_HOME}/bin/llvm-dis  "$bitcode" &> /dev/null
+done
+
+exit 0
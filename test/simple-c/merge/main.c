@@ -0,0 +1,11 @@
+#include <stdio.h>
+
+extern int scale(int mode, int x);
+
+int main(void) {
+  int c = getchar();
+  /// EXPECTED: scale is specialized for mode 1 and mode 2 but the
+  /// two copies are merged and both calls go to the one kept
+  printf("%d %d\n", scale(1, c), scale(2, c));
+  return 0;
+}
@@ -0,0 +1,4 @@
+/* mode is ignored so all the copies of scale are identical */
+int scale(int mode, int x) {
+  return 3 * x + 1;
+}
@@ -0,0 +1,35 @@
+#!/usr/bin/env bash
+
+#make the bitcode
+CC=gclang make
+get-bc main.o
+
+export OCCAM_LOGLEVEL=INFO
+export OCCAM_LOGFILE=${PWD}/slash/occam.log
+export PATH=${LLVM_HOME}/bin:${PATH}
+
+# Collect the profile from an IR-instrumented build of the same bitcode
+opt -pgo-instr-gen -instrprof main.o.bc -o main.pgo.bc
+clang -fprofile-instr-generate main.pgo.bc -o main_pgo
+LLVM_PROFILE_FILE=main.profraw ./main_pgo 1000
+llvm-profdata merge -o main.profdata main.profraw
+
+# Build the manifest file
+cat > multiple.manifest <<EOF
+{ "main" : "main.o.bc"
+, "binary"  : "main"
+, "modules"    : []
+, "native_libs" : []
+, "name"    : "main"
+, "profile" : "main.profdata"
+}
+EOF
+
+slash --no-strip --devirt=sea_dsa --disable-inlining --work-dir=slash multiple.manifest 
+
+#debugging stuff below:
+for bitcode in slash/*.bc; do
+    ${LLVM_HOME}/bin/llvm-dis  "$bitcode" &> /dev/null
+done
+
+exit 0
@@ -0,0 +1,33 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The profile is collected before add and sub are internalized */
+typedef int (*binop_t)(int, int);
+
+__attribute__((noinline))
+int add(int x, int y) {
+  return x + y;
+}
+
+__attribute__((noinline))
+int sub(int x, int y) {
+  return x - y;
+}
+
+binop_t ops[2] = {&add, &sub};
+
+int main(int argc, char** argv) {
+  if (argc > 2) {
+    ops[0] = &sub;
+  }
+  int n = argc > 1 ? atoi(argv[1]) : 0;
+  int res = 0;
+  int i;
+  for (i = 0; i < n; ++i) {
+    /// EXPECTED: sub is called 9 times out of 10 so the bounce
+    /// function tests it first
+    res = ops[i % 10 != 0](res, i);
+  }
+  printf("%d\n", res);
+  return 0;
+}
@@ -0,0 +1,14 @@
+#include <stdio.h>
+
+/* mode decides the branch that is taken */
+int dispatch(int mode, int c){
+  if(mode == 1){ puts("one"); return putchar(c); }
+  if(mode == 2){ puts("two"); putchar(c); return putchar(c); }
+  puts("other");
+  return 0;
+}
+
+/* mode is ignored */
+int scale(int mode, int x){
+  return 3 * x + 1;
+}
@@ -0,0 +1,2 @@
+extern int dispatch(int, int);
+extern int scale(int, int);
@@ -0,0 +1,14 @@
+#include "library.h"
+
+#include <stdio.h>
+
+int main(int argc, char* argv[]){
+  int c = getchar();
+  /// EXPECTED: dispatch is specialized for mode 1 because this folds
+  /// its branches, scale is not because mode is ignored
+  int r1 = dispatch(1, c);
+  int r2 = scale(1, c);
+
+  printf("%d %d\n", r1, r2);
+  return 0;
+}
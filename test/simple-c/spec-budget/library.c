@@ -0,0 +1,19 @@
+#include <stdio.h>
+
+/* mode decides most of pick */
+int pick(int mode, int c){
+  if(mode == 1){
+    puts("one");
+    putchar(c); putchar(c + 1); putchar(c + 2); putchar(c + 3);
+    return 1;
+  }
+  puts("other");
+  putchar(c + 4); putchar(c + 5); putchar(c + 6);
+  return 2;
+}
+
+/* mode only changes the last character */
+int echo(int mode, int c){
+  putchar(c); putchar(c + 1); putchar(c + 2); putchar(c + 3); putchar(c + 4);
+  return putchar(c + mode);
+}
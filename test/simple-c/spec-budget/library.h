@@ -0,0 +1,2 @@
+extern int pick(int, int);
+extern int echo(int, int);
@@ -0,0 +1,16 @@
+#include "library.h"
+
+#include <stdio.h>
+
+int main(int argc, char* argv[]){
+  int c = getchar();
+  /// EXPECTED: both calls can be specialized on their own but the
+  /// budget only covers one copy. pick goes first because its mode
+  /// folds most of it. echo is never specialized, even after the
+  /// original pick has been removed.
+  int r1 = pick(1, c);
+  int r2 = echo(2, c);
+
+  printf("%d %d\n", r1, r2);
+  return 0;
+}
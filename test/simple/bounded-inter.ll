@@ -14,21 +14,21 @@ declare i32 @printf(i8*, ...) local_unnamed_addr #0
 
 ; Function Attrs: nounwind
 define i32 @main(i32, i8** nocapture readnone) local_unnamed_addr #1 {
-  ; CHECK: "__occam_spec.libcall(0x1,0x2)"
-  %call.i2 = tail call i32 @"__occam_spec.libcall(0x1,0x2)"() #1
-  ; CHECK: "__occam_spec.libcall(0x3,0x4)"
-  %call1.i1 = tail call i32 @"__occam_spec.libcall(0x3,0x4)"() #1
-  ; CHECK-NOT: "__occam_spec.libcall(0x5,0x6)"  
+  ; CHECK: __occam_spec.libcall.b867b67c7bb6de66
+  %call.i2 = tail call i32 @__occam_spec.libcall.b867b67c7bb6de66() #1
+  ; CHECK: __occam_spec.libcall.585456471bb817fb
+  %call1.i1 = tail call i32 @__occam_spec.libcall.585456471bb817fb() #1
+  ; CHECK-NOT: __occam_spec.libcall.3b9b31e617b32bee  
   %call2.i = tail call i32 @libcall(i32 5, i32 6) #1
-  ; CHECK-NOT: "__occam_spec.libcall(0x7,0x8)"    
+  ; CHECK-NOT: __occam_spec.libcall.6dfd65a8e3922bab    
   %call3.i = tail call i32 @libcall(i32 7, i32 8) #1
   %call4.i = tail call i32 (i8*, ...) @printf(i8* getelementptr inbounds ([13 x i8], [13 x i8]* @.str, i64 0, i64 0), i32 %call.i2, i32 %call1.i1, i32 %call2.i, i32 %call3.i) #1
   ret i32 0
 }
 
-declare i32 @"__occam_spec.libcall(0x3,0x4)"() local_unnamed_addr
+declare i32 @__occam_spec.libcall.585456471bb817fb() local_unnamed_addr
 
-declare i32 @"__occam_spec.libcall(0x1,0x2)"() local_unnamed_addr
+declare i32 @__occam_spec.libcall.b867b67c7bb6de66() local_unnamed_addr
 
 attributes #0 = { "correctly-rounded-divide-sqrt-fp-math"="false" "disable-tail-calls"="false" "less-precise-fpmad"="false" "no-frame-pointer-elim"="true" "no-frame-pointer-elim-non-leaf" "no-infs-fp-math"="false" "no-nans-fp-math"="false" "no-signed-zeros-fp-math"="false" "no-trapping-math"="false" "stack-protector-buffer-size"="8" "target-cpu"="x86-64" "target-features"="+fxsr,+mmx,+sse,+sse2,+x87" "unsafe-fp-math"="false" "use-soft-float"="false" }
 attributes #1 = { nounwind }
@@ -60,28 +60,28 @@ define i32 @main(i32, i8** nocapture readnone) local_unnamed_addr #3 {
   %call.i = tail call fastcc i32 @nd_int() #3
   %call1.i = tail call fastcc i32 @nd_int() #3
   %call2.i = tail call fastcc i32 @libcall(i32 %call.i) #3
-  ; CHECK-NOT: "__occam_spec.libcall(0x1)"
+  ; CHECK-NOT: __occam_spec.libcall.78d9e8b5b8e351f4
   %call3.i = tail call fastcc i32 @libcall(i32 1) #3
-  ; CHECK-NOT: "__occam_spec.libcall(0x3)"  
+  ; CHECK-NOT: __occam_spec.libcall.cb35130a900a2cb0  
   %call4.i = tail call fastcc i32 @libcall(i32 3) #3
-  ; CHECK: "__occam_spec.libcall(0x5)"    
-  %call5.i2 = tail call fastcc i32 @"__occam_spec.libcall(0x5)"()
-  ; CHECK: "__occam_spec.libcall(0x7)"    
-  %call6.i1 = tail call fastcc i32 @"__occam_spec.libcall(0x7)"()
+  ; CHECK: __occam_spec.libcall.08d1ffd85f169268    
+  %call5.i2 = tail call fastcc i32 @__occam_spec.libcall.08d1ffd85f169268()
+  ; CHECK: __occam_spec.libcall.424be0cf11edb6c2    
+  %call6.i1 = tail call fastcc i32 @__occam_spec.libcall.424be0cf11edb6c2()
   
   %call7.i = tail call i32 (i8*, ...) @printf(i8* getelementptr inbounds ([16 x i8], [16 x i8]* @.str, i64 0, i64 0), i32 %call2.i, i32 %call3.i, i32 %call4.i, i32 %call5.i2, i32 %call6.i1) #3
   ret i32 0
 }
 
 ; Function Attrs: noinline nounwind uwtable
-define internal fastcc i32 @"__occam_spec.libcall(0x7)"() unnamed_addr #0 {
+define internal fastcc i32 @__occam_spec.libcall.424be0cf11edb6c2() unnamed_addr #0 {
 entry:
   %call8 = tail call fastcc i32 @nd_int()
   ret i32 %call8
 }
 
 ; Function Attrs: noinline nounwind uwtable
-define internal fastcc i32 @"__occam_spec.libcall(0x5)"() unnamed_addr #0 {
+define internal fastcc i32 @__occam_spec.libcall.08d1ffd85f169268() unnamed_addr #0 {
 entry:
   %call8 = tail call fastcc i32 @nd_int()
   ret i32 %call8
@@ -10,7 +10,7 @@ target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
 target triple = "x86_64-apple-macosx10.14.0"
 
 ; Function Attrs: norecurse nounwind readnone ssp uwtable
-define i32 @"__occam_spec.fibo_lib(0xF)"() local_unnamed_addr #0 {
+define i32 @__occam_spec.fibo_lib.7a5057a64de48186() local_unnamed_addr #0 {
   ; CHECK: 610
   ret i32 610
 }
@@ -11,8 +11,8 @@ target triple = "x86_64-apple-macosx10.14.0"
 
 ; Function Attrs: noinline nounwind ssp uwtable
 define i32 @main() local_unnamed_addr #0 {
-  ; CHECK: "__occam_spec.execute_call(incr,0x5)"
-  %1 = tail call i32 @"__occam_spec.execute_call(incr,0x5)"() #3
+  ; CHECK: __occam_spec.execute_call.3b7e111c1622ae36
+  %1 = tail call i32 @__occam_spec.execute_call.3b7e111c1622ae36() #3
   %2 = icmp eq i32 %1, 6
   br i1 %2, label %3, label %5
 
@@ -30,11 +30,11 @@ define i32 @main() local_unnamed_addr #0 {
 
 declare i32 @printf(i8*, ...) local_unnamed_addr #1
 
-declare i32 @"__occam_spec.execute_call(incr,0x5)"() local_unnamed_addr
+declare i32 @__occam_spec.execute_call.3b7e111c1622ae36() local_unnamed_addr
 
 ; Function Attrs: noinline norecurse nounwind readnone ssp uwtable
-; CHECK: "__occam_spec.incr(0x5)"
-define i32 @"__occam_spec.incr(0x5)"() local_unnamed_addr #2 {
+; CHECK: __occam_spec.incr.58e3cc828983c519
+define i32 @__occam_spec.incr.58e3cc828983c519() local_unnamed_addr #2 {
   ; CHECK: 6
   ret i32 6
 }
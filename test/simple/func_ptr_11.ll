@@ -27,8 +27,8 @@ define internal fastcc void @init() unnamed_addr #1 {
 define i32 @main() local_unnamed_addr #2 {
   tail call fastcc void @init()
   %1 = load i32 (i32)*, i32 (i32)** @_fun, align 8
-  ; CHECK: "__occam_spec.execute_call(incr,0x5)"
-  %2 = tail call i32 @"__occam_spec.execute_call(?,0x5)"(i32 (i32)* %1) #4
+  ; CHECK: __occam_spec.execute_call.3b7e111c1622ae36
+  %2 = tail call i32 @__occam_spec.execute_call.6714a21579db9ae1(i32 (i32)* %1) #4
   %3 = icmp eq i32 %2, 6
   br i1 %3, label %4, label %6
 
@@ -46,7 +46,7 @@ define i32 @main() local_unnamed_addr #2 {
 
 declare i32 @printf(i8*, ...) local_unnamed_addr #3
 
-declare i32 @"__occam_spec.execute_call(?,0x5)"(i32 (i32)*) local_unnamed_addr
+declare i32 @__occam_spec.execute_call.6714a21579db9ae1(i32 (i32)*) local_unnamed_addr
 
 attributes #0 = { noinline norecurse nounwind readnone ssp uwtable "correctly-rounded-divide-sqrt-fp-math"="false" "disable-tail-calls"="false" "less-precise-fpmad"="false" "no-frame-pointer-elim"="true" "no-frame-pointer-elim-non-leaf" "no-infs-fp-math"="false" "no-jump-tables"="false" "no-nans-fp-math"="false" "no-signed-zeros-fp-math"="false" "no-trapping-math"="false" "stack-protector-buffer-size"="8" "target-cpu"="penryn" "target-features"="+cx16,+fxsr,+mmx,+sse,+sse2,+sse3,+sse4.1,+ssse3,+x87" "unsafe-fp-math"="false" "use-soft-float"="false" }
 attributes #1 = { noinline norecurse nounwind ssp uwtable "correctly-rounded-divide-sqrt-fp-math"="false" "disable-tail-calls"="false" "less-precise-fpmad"="false" "no-frame-pointer-elim"="true" "no-frame-pointer-elim-non-leaf" "no-infs-fp-math"="false" "no-jump-tables"="false" "no-nans-fp-math"="false" "no-signed-zeros-fp-math"="false" "no-trapping-math"="false" "stack-protector-buffer-size"="8" "target-cpu"="penryn" "target-features"="+cx16,+fxsr,+mmx,+sse,+sse2,+sse3,+sse4.1,+ssse3,+x87" "unsafe-fp-math"="false" "use-soft-float"="false" }
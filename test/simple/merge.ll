@@ -0,0 +1,15 @@
+; RUN: cd %merge && %merge/build.sh
+; RUN: %llvm_dis < %merge/slash/scale.o.i.p.s.bc | FileCheck %s --check-prefix=SPEC
+; RUN: %llvm_as < %merge/slash/main.o-final.ll | %llvm_dis | FileCheck %s
+
+; scale(1, c) and scale(2, c) give two identical copies. The second
+; one is folded into the first and kept as an alias so that main can
+; still call it by name.
+; SPEC: @__occam_spec.scale.{{[0-9a-f]+}} = alias
+; SPEC: define {{.*}}@__occam_spec.scale.
+; SPEC-NOT: define {{.*}}@__occam_spec.scale.
+
+; and the rewrites of main call the copy that is kept
+; CHECK-LABEL: define {{.*}}@main(
+; CHECK: call i32 @[[SPEC:__occam_spec\.scale\.[0-9a-f]+]](
+; CHECK: call i32 @[[SPEC]](
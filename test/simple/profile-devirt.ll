@@ -0,0 +1,10 @@
+; RUN: cd %profile_devirt && %profile_devirt/build.sh
+; RUN: %llvm_as < %profile_devirt/slash/main.o-final.ll | %llvm_dis | FileCheck %s
+
+; The value profile of the indirect call names add and sub by the
+; hash of their names before internalization. The bounce function
+; must still test the hottest target (sub) first.
+
+; CHECK-LABEL: define {{.*}}@__occam.bounce
+; CHECK: icmp eq {{.*}}@sub
+; CHECK: icmp eq {{.*}}@add
@@ -0,0 +1,11 @@
+; RUN: cd %profitable && %profitable/build.sh
+; RUN: %llvm_as < slash/main-final.ll | %llvm_dis | FileCheck %s
+
+; With -Pspecialize-policy=profitable only the calls whose constant
+; arguments simplify the callee are specialized. The mode of dispatch
+; decides its branches, the mode of scale is ignored.
+; CHECK-NOT: __occam_spec.scale
+; CHECK-LABEL: define {{.*}}@main(
+; CHECK: call i32 @__occam_spec.dispatch.14972f103869dd84(
+; CHECK: call i32 @scale(i32 1,
+; CHECK-NOT: __occam_spec.scale
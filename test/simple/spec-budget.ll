@@ -0,0 +1,17 @@
+; RUN: cd %spec_budget && %spec_budget/build.sh
+; RUN: %llvm_as < %spec_budget/slash/main-final.ll | %llvm_dis | FileCheck %s
+; RUN: %llvm_as < %spec_budget/slash/library.so-final.ll | %llvm_dis | FileCheck %s --check-prefix=LIB
+
+; --spec-budget=80 lets the library grow by 80% of its size. This pays
+; for one copy of pick or of echo but not for both. pick ranks first
+; because its mode folds most of it, so echo is skipped. The budget is
+; kept in !previrt.budget: the second iteration of the fixpoint, after
+; the original pick is gone, must not afford echo either.
+; CHECK-LABEL: define {{.*}}@main(
+; CHECK: call i32 @__occam_spec.pick.1e8665467c87ae0e(
+; CHECK: call i32 @echo(i32 2,
+
+; LIB-NOT: __occam_spec.echo
+; LIB: define {{.*}}@__occam_spec.pick.1e8665467c87ae0e(
+; LIB-NOT: __occam_spec.echo
+; LIB: !previrt.budget = !{